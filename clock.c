@@ -26,12 +26,113 @@
 #include <gpac/internal/compositor_dev.h>
 #ifndef GPAC_DISABLE_COMPOSITOR
 
+/*clock timing state is read from the audio, video and systems threads and rarely modified: it is protected by a sequence
+counter, readers retry if the counter changed or was odd (update in progress), writers serialize on the counter*/
+#if defined(WIN32) || defined(_WIN32_WCE)
+#define CK_CAS(_v, _old, _new)	(InterlockedCompareExchange((LONG volatile *) (_v), (LONG) (_new), (LONG) (_old)) == (LONG) (_old))
+#define CK_FENCE()	MemoryBarrier()
+#else
+#define CK_CAS(_v, _old, _new)	__sync_bool_compare_and_swap(_v, _old, _new)
+#define CK_FENCE()	__sync_synchronize()
+#endif
+
+static void gf_clock_write_begin(GF_Clock *ck)
+{
+	while (1) {
+		u32 seq = ck->seq;
+		if (!(seq & 1) && CK_CAS(&ck->seq, seq, seq+1))
+			return;
+	}
+}
+
+static void gf_clock_write_end(GF_Clock *ck)
+{
+	CK_FENCE();
+	ck->seq++;
+}
+
+static u32 gf_clock_read_begin(GF_Clock *ck)
+{
+	u32 seq;
+	while ((seq = ck->seq) & 1) { }
+	CK_FENCE();
+	return seq;
+}
+
+static Bool gf_clock_read_retry(GF_Clock *ck, u32 seq)
+{
+	CK_FENCE();
+	return (ck->seq != seq) ? GF_TRUE : GF_FALSE;
+}
+
+/*deleted clocks are recycled, so that services creating and destroying clocks do not go through the allocator each time.
+The pool is released once no clock is in use anymore*/
+#define CK_POOL_SIZE	16
+static GF_Clock *ck_pool[CK_POOL_SIZE];
+static u32 ck_pool_count = 0;
+static u32 ck_nb_alive = 0;
+static volatile u32 ck_pool_lock = 0;
+
+static void gf_clock_pool_lock()
+{
+	while (!CK_CAS(&ck_pool_lock, 0, 1)) { }
+}
+
+static void gf_clock_pool_unlock()
+{
+	CK_FENCE();
+	ck_pool_lock = 0;
+}
+
+/*time source of all clocks, the compositor clock unless a virtual one is set*/
+static u32 (*ck_time_source)(void *udta, GF_Compositor *compositor) = NULL;
+static void *ck_time_source_udta = NULL;
+
+void gf_clock_set_time_source(u32 (*get_time)(void *udta, GF_Compositor *compositor), void *udta)
+{
+	ck_time_source_udta = udta;
+	ck_time_source = get_time;
+}
+
+static u32 gf_clock_source_time(GF_Compositor *compositor)
+{
+	if (ck_time_source) return ck_time_source(ck_time_source_udta, compositor);
+	return gf_sc_get_clock(compositor);
+}
+
+/*time source in us: the realtime compositor clock is the system clock, read at full resolution
+virtual time sources and frame-driven compositor clocks only have ms resolution*/
+static u64 gf_clock_source_time_us(GF_Compositor *compositor)
+{
+	if (!ck_time_source && (!compositor || (compositor->player && !compositor->bench_mode)))
+		return gf_sys_clock_high_res();
+	return (u64) gf_clock_source_time(compositor) * 1000;
+}
+
 static GF_Clock *gf_clock_new(GF_Compositor *compositor)
 {
-	GF_Clock *tmp;
-	GF_SAFEALLOC(tmp, GF_Clock);
-	if (!tmp) return NULL;
-	tmp->mx = gf_mx_new("Clock");
+	GF_Clock *tmp = NULL;
+	gf_clock_pool_lock();
+	if (ck_pool_count) {
+		ck_pool_count--;
+		tmp = ck_pool[ck_pool_count];
+	}
+	ck_nb_alive++;
+	gf_clock_pool_unlock();
+
+	if (tmp) {
+		memset(tmp, 0, sizeof(GF_Clock));
+	} else {
+		GF_SAFEALLOC(tmp, GF_Clock);
+		if (!tmp) {
+			gf_clock_pool_lock();
+			ck_nb_alive--;
+			gf_clock_pool_unlock();
+			return NULL;
+		}
+	}
+	//clock state is protected by its sequence counter, no mutex needed
+	tmp->mx = NULL;
 	tmp->compositor = compositor;
 	tmp->speed = FIX_ONE;
 	tmp->timeline_id = 1;
@@ -40,45 +141,97 @@ static GF_Clock *gf_clock_new(GF_Compositor *compositor)
 
 void gf_clock_del(GF_Clock *ck)
 {
-	gf_mx_del(ck->mx);
-	gf_free(ck);
+	u32 i, nb_free = 0;
+	GF_Clock *to_free[CK_POOL_SIZE+1];
+
+	if (ck->mx) gf_mx_del(ck->mx);
+	ck->mx = NULL;
+
+	gf_clock_pool_lock();
+	if (ck_nb_alive) ck_nb_alive--;
+	if (ck_pool_count < CK_POOL_SIZE) {
+		ck_pool[ck_pool_count] = ck;
+		ck_pool_count++;
+	} else {
+		to_free[nb_free++] = ck;
+	}
+	//no more clocks in use, release the pool
+	if (!ck_nb_alive) {
+		while (ck_pool_count) {
+			ck_pool_count--;
+			to_free[nb_free++] = ck_pool[ck_pool_count];
+		}
+	}
+	gf_clock_pool_unlock();
+
+	for (i=0; i<nb_free; i++)
+		gf_free(to_free[i]);
+}
+
+/*clocks of a namespace are kept sorted by clock ID, returns the position of the first clock with an ID greater or equal to clock_id*/
+static u32 gf_clock_lower_bound(GF_List *Clocks, u16 clock_id)
+{
+	u32 lo=0, hi=gf_list_count(Clocks);
+	while (lo<hi) {
+		u32 mid = (lo+hi)/2;
+		GF_Clock *ck = gf_list_get(Clocks, mid);
+		if (ck->clock_id < clock_id) lo = mid+1;
+		else hi = mid;
+	}
+	return lo;
+}
+
+static GF_Clock *gf_clock_get(GF_List *Clocks, u16 clock_id, u32 *pos)
+{
+	u32 idx = gf_clock_lower_bound(Clocks, clock_id);
+	GF_Clock *ck = gf_list_get(Clocks, idx);
+	if (!ck || (ck->clock_id != clock_id)) return NULL;
+	if (pos) *pos = idx;
+	return ck;
+}
+
+static void gf_clock_insert(GF_List *Clocks, GF_Clock *ck)
+{
+	gf_list_insert(Clocks, ck, gf_clock_lower_bound(Clocks, ck->clock_id));
 }
 
 GF_Clock *gf_clock_find(GF_List *Clocks, u16 clock_id, u16 ES_ID)
 {
-	u32 i;
 	GF_Clock *tmp;
-	i=0;
-	while ((tmp = (GF_Clock *)gf_list_enum(Clocks, &i))) {
-		//first check the clock ID
-		if (tmp->clock_id == clock_id) return tmp;
-		//then check the ES ID
-		if (ES_ID && (tmp->clock_id == ES_ID)) return tmp;
-	}
+	//first check the clock ID
+	tmp = gf_clock_get(Clocks, clock_id, NULL);
+	if (tmp) return tmp;
+	//then check the ES ID
+	if (ES_ID) return gf_clock_get(Clocks, ES_ID, NULL);
 	//no clocks found...
 	return NULL;
 }
 
+/*returns TRUE if the main or one of the extra PIDs of the object has the given ID*/
+static Bool gf_ck_odm_has_pid(GF_ObjectManager *odm, u16 pid_id)
+{
+	u32 i, count;
+	if (odm->pid_id == pid_id) return GF_TRUE;
+	//most objects have no extra PIDs
+	count = odm->extra_pids ? gf_list_count(odm->extra_pids) : 0;
+	for (i=0; i<count; i++) {
+		GF_ODMExtraPid *xpid = gf_list_get(odm->extra_pids, i);
+		if (xpid->pid_id == pid_id) return GF_TRUE;
+	}
+	return GF_FALSE;
+}
+
 static GF_Clock *gf_ck_look_for_clock_dep(GF_Scene *scene, u16 clock_id)
 {
-	u32 i, j;
-	GF_ODMExtraPid *xpid;
-	GF_ObjectManager *odm;
+	u32 i, count;
 
 	/*check in top OD*/
-	if (scene->root_od->pid_id == clock_id) return scene->root_od->ck;
-	i=0;
-	while ((xpid = (GF_ODMExtraPid*)gf_list_enum(scene->root_od->extra_pids, &i))) {
-		if (xpid->pid_id == clock_id) return scene->root_od->ck;
-	}
+	if (gf_ck_odm_has_pid(scene->root_od, clock_id)) return scene->root_od->ck;
 	/*check in sub ODs*/
-	j=0;
-	while ((odm = (GF_ObjectManager*)gf_list_enum(scene->resources, &j))) {
-		if (odm->pid_id == clock_id) return odm->ck;
-		i=0;
-		while ((xpid = (GF_ODMExtraPid*)gf_list_enum(odm->extra_pids, &i))) {
-			if (xpid->pid_id == clock_id) return odm->ck;
-		}
+	count = gf_list_count(scene->resources);
+	for (i=0; i<count; i++) {
+		GF_ObjectManager *odm = gf_list_get(scene->resources, i);
+		if (gf_ck_odm_has_pid(odm, clock_id)) return odm->ck;
 	}
 	return NULL;
 }
@@ -86,36 +239,38 @@ static GF_Clock *gf_ck_look_for_clock_dep(GF_Scene *scene, u16 clock_id)
 /*remove clocks created due to out-of-order OCR dependencies*/
 static void gf_ck_resolve_clock_dep(GF_List *clocks, GF_Scene *scene, GF_Clock *new_ck, u16 Clock_ESID)
 {
-	u32 i;
+	u32 i, count;
 	GF_Clock *clock;
-	GF_ObjectManager *odm;
 
+	gf_rmt_begin(gf_ck_resolve_clock_dep, GF_RMT_AGGREGATE);
 	/*check all objects - if any uses a clock which ID == the clock_ESID then
 	this clock shall be removed*/
 	if (scene->root_od->ck && (scene->root_od->ck->clock_id == Clock_ESID)) {
 		scene->root_od->ck = new_ck;
 	}
-	i=0;
-	while ((odm = (GF_ObjectManager*)gf_list_enum(scene->resources, &i))) {
+	count = gf_list_count(scene->resources);
+	for (i=0; i<count; i++) {
+		GF_ObjectManager *odm = gf_list_get(scene->resources, i);
 		if (odm->ck && (odm->ck->clock_id == Clock_ESID)) {
 			odm->ck = new_ck;
 		}
 	}
 	/*destroy clock*/
-	i=0;
-	while ((clock = (GF_Clock*)gf_list_enum(clocks, &i))) {
-		if (clock->clock_id == Clock_ESID) {
-			gf_list_rem(clocks, i-1);
-			gf_clock_del(clock);
-			return;
-		}
+	clock = gf_clock_get(clocks, Clock_ESID, &i);
+	if (clock) {
+		gf_list_rem(clocks, i);
+		gf_clock_del(clock);
 	}
+	gf_rmt_end();
 }
 
 GF_Clock *gf_clock_attach(GF_List *clocks, GF_Scene *scene, u16 clock_id, u16 ES_ID, s32 hasOCR)
 {
 	Bool check_dep;
-	GF_Clock *tmp = gf_clock_find(clocks, clock_id, ES_ID);
+	GF_Clock *tmp;
+
+	gf_rmt_begin(gf_clock_attach, GF_RMT_AGGREGATE);
+	tmp = gf_clock_find(clocks, clock_id, ES_ID);
 	/*ck dep can only be solved if in the main service*/
 	check_dep = (scene->root_od->scene_ns && scene->root_od->scene_ns->clocks==clocks) ? GF_TRUE : GF_FALSE;
 
@@ -124,98 +279,155 @@ GF_Clock *gf_clock_attach(GF_List *clocks, GF_Scene *scene, u16 clock_id, u16 ES
 	if (!tmp) {
 		tmp = gf_clock_new(scene->compositor);
 		tmp->clock_id = clock_id;
-		gf_list_add(clocks, tmp);
+		gf_clock_insert(clocks, tmp);
 	} else {
-		if (tmp->clock_id == ES_ID) tmp->clock_id = clock_id;
+		if (tmp->clock_id == ES_ID) {
+			//clock ID changes, move it to keep the list sorted
+			u32 pos;
+			s32 idx = (gf_clock_get(clocks, ES_ID, &pos) == tmp) ? (s32) pos : gf_list_find(clocks, tmp);
+			if (idx>=0) {
+				gf_list_rem(clocks, idx);
+				tmp->clock_id = clock_id;
+				gf_clock_insert(clocks, tmp);
+			} else {
+				tmp->clock_id = clock_id;
+			}
+		}
 		/*this finally solves a->b->c*/
 		if (check_dep && (tmp->clock_id != ES_ID)) gf_ck_resolve_clock_dep(clocks, scene, tmp, ES_ID);
 	}
+	gf_rmt_end();
 	return tmp;
 }
 
 void gf_clock_reset(GF_Clock *ck)
 {
+	gf_clock_write_begin(ck);
 	ck->clock_init = 0;
 	ck->audio_delay = 0;
 	ck->speed_set_time = 0;
+	ck->speed_set_time_us = 0;
 	//do NOT reset buffering flag, because RESET scene called only
 	//for the stream owning the clock, and other streams may
 	//have signaled buffering on this clock
 	ck->init_timestamp = 0;
 	ck->start_time = 0;
+	ck->start_time_us = 0;
 	ck->has_seen_eos = 0;
 	ck->has_media_time_shift = GF_FALSE;
 	//do NOT reset media timestamp mapping once the clock is init
 	//if discontinuities are found the media time mapping will be adjusted then
 	ck->timeline_id++;
+	gf_clock_write_end(ck);
 }
 
 void gf_clock_set_time(GF_Clock *ck, u64 ref_TS, u32 timescale)
 {
 	if (!ck->clock_init) {
 		u64 real_ts_ms = gf_timestamp_rescale(ref_TS, timescale, 1000);
-		ck->init_ts_loops = (u32) (real_ts_ms / 0xFFFFFFFFUL);
-		ck->init_timestamp = (u32) (real_ts_ms % 0xFFFFFFFFUL);
-		ck->clock_init = 1;
-		ck->audio_delay = 0;
-		/*update starttime and pausetime even in pause mode*/
-		ck->pause_time = ck->start_time = gf_sc_get_clock(ck->compositor);
+		gf_clock_write_begin(ck);
+		//may have been initialized while waiting for the lock
+		if (!ck->clock_init) {
+			ck->init_ts_loops = (u32) (real_ts_ms / 0xFFFFFFFFUL);
+			ck->init_timestamp = (u32) (real_ts_ms % 0xFFFFFFFFUL);
+			ck->clock_init = 1;
+			ck->audio_delay = 0;
+			/*update starttime and pausetime even in pause mode*/
+			ck->pause_time = ck->start_time = gf_clock_source_time(ck->compositor);
+			ck->pause_time_us = ck->start_time_us = gf_clock_source_time_us(ck->compositor);
+		}
+		gf_clock_write_end(ck);
 	}
 }
 
 
-
-void gf_clock_pause(GF_Clock *ck)
+//pause and resume with the clock write lock held
+static void gf_clock_pause_locked(GF_Clock *ck)
 {
-	gf_mx_p(ck->mx);
-	if (!ck->nb_paused)
-		ck->pause_time = gf_sc_get_clock(ck->compositor);
+	if (!ck->nb_paused) {
+		ck->pause_time = gf_clock_source_time(ck->compositor);
+		ck->pause_time_us = gf_clock_source_time_us(ck->compositor);
+	}
 	ck->nb_paused += 1;
-	gf_mx_v(ck->mx);
 }
 
-void gf_clock_resume(GF_Clock *ck)
+static void gf_clock_resume_locked(GF_Clock *ck)
 {
-	gf_mx_p(ck->mx);
 	if (ck->nb_paused)
 		ck->nb_paused -= 1;
 	//in player mode, increment the start time to reflect how long we have been buffering
 	//in non-player mode, since we don't care about real-time, don't update the clock start time
 	//this avoids cases where the first composed frame is dispatched while the object(s) are buffering
 	//updating the clock would rewind the timebase in the past and won't trigger next frame fetch on these objects
-	if (!ck->nb_paused && ck->compositor->player)
-		ck->start_time += gf_sc_get_clock(ck->compositor) - ck->pause_time;
-	gf_mx_v(ck->mx);
+	if (!ck->nb_paused) {
+		u32 paused = gf_clock_source_time(ck->compositor) - ck->pause_time;
+		u64 paused_us = gf_clock_source_time_us(ck->compositor) - ck->pause_time_us;
+		ck->paused_time += paused;
+		//no compositor with a virtual time source
+		if (!ck->compositor || ck->compositor->player) {
+			ck->start_time += paused;
+			ck->start_time_us += paused_us;
+		}
+	}
 }
 
+void gf_clock_pause(GF_Clock *ck)
+{
+	gf_clock_write_begin(ck);
+	gf_clock_pause_locked(ck);
+	gf_clock_write_end(ck);
+}
 
-u32 gf_clock_real_time(GF_Clock *ck)
+void gf_clock_resume(GF_Clock *ck)
 {
-	u32 time;
-	if (!ck) return 0;
-	if (!ck->clock_init) return ck->start_time;
-	time = ck->nb_paused > 0 ? ck->pause_time : gf_sc_get_clock(ck->compositor);
+	gf_clock_write_begin(ck);
+	gf_clock_resume_locked(ck);
+	gf_clock_write_end(ck);
+}
 
+//computes clock time in us on the 64-bit timeline from the current state, caller must ensure the state is consistent
+static u64 gf_clock_real_time_us_nolock(GF_Clock *ck)
+{
+	u64 time, init_us;
+	s64 elapsed;
+	if (!ck->clock_init) return (u64) ck->start_time * 1000;
+	init_us = ((u64) ck->init_ts_loops * 0xFFFFFFFFUL + ck->init_timestamp) * 1000;
+	time = ck->nb_paused > 0 ? ck->pause_time_us : gf_clock_source_time_us(ck->compositor);
+	elapsed = (s64) (time - ck->start_time_us);
+
+	//scaled playback, in double precision since elapsed time in us exceeds float precision
+	if (ck->speed != FIX_ONE) {
 #ifdef GPAC_FIXED_POINT
-
-	if ((ck->speed < 0) && ((s32) ck->init_timestamp < FIX2INT( (-ck->speed * 100) * (time - ck->start_time)) / 100 ) ) {
-		time = 0;
-	} else {
-		time = ck->speed_set_time + ck->init_timestamp + (time - ck->start_time) * FIX2INT(100*ck->speed) / 100;
-	}
-
+		elapsed = elapsed * FIX2INT(100*ck->speed) / 100;
 #else
-
-	if ((ck->speed < 0) && ((s32) ck->init_timestamp < (-ck->speed) * (time - ck->start_time))) {
-		time = 0;
-	} else {
-		//DO NOT CHANGE the position of cast float->u32, otherwise we have precision issues when ck->init_timestamp
-		//is >= 0x40000000. We know for sure that ck->speed * (time - ck->start_time) is positive
-		time = ck->speed_set_time + ck->init_timestamp + (u32) (ck->speed * (time - ck->start_time) );
+		elapsed = (s64) ((Double) ck->speed * elapsed);
+#endif
 	}
+	elapsed += ck->speed_set_time_us;
+	//backward playback before the init timestamp
+	if ((elapsed < 0) && ((u64) -elapsed > init_us)) return 0;
+	return init_us + elapsed;
+}
 
-#endif
+//computes clock time in ms from the us timeline, with 32-bit wrapping
+static u32 gf_clock_real_time_nolock(GF_Clock *ck)
+{
+	u64 time, loops;
+	if (!ck->clock_init) return ck->start_time;
+	time = gf_clock_real_time_us_nolock(ck) / 1000;
+	loops = (u64) ck->init_ts_loops * 0xFFFFFFFFUL;
+	if (time < loops) return 0;
+	return (u32) (time - loops);
+}
 
+u32 gf_clock_real_time(GF_Clock *ck)
+{
+	u32 seq, time;
+	if (!ck) return 0;
+	do {
+		seq = gf_clock_read_begin(ck);
+		time = gf_clock_real_time_nolock(ck);
+	} while (gf_clock_read_retry(ck, seq));
 	return time;
 }
 
@@ -252,7 +464,7 @@ u64 gf_clock_media_time(GF_Clock *ck)
 u32 gf_clock_elapsed_time(GF_Clock *ck)
 {
 	if (!ck || ck->nb_buffering || ck->nb_paused) return 0;
-	return gf_sys_clock() - ck->start_time;
+	return gf_clock_source_time(ck->compositor) - ck->start_time;
 }
 
 Bool gf_clock_is_started(GF_Clock *ck)
@@ -261,37 +473,86 @@ Bool gf_clock_is_started(GF_Clock *ck)
 	return 1;
 }
 
-/*buffering scene protected by a mutex because it may be triggered by composition memory (audio or visual threads)*/
+/*buffering state protected by the clock write lock because it may be triggered by composition memory (audio or visual threads)*/
 void gf_clock_buffer_on(GF_Clock *ck)
 {
-	gf_mx_p(ck->mx);
-	if (!ck->nb_buffering) gf_clock_pause(ck);
+	gf_clock_write_begin(ck);
+	if (!ck->nb_buffering) {
+		gf_clock_pause_locked(ck);
+		ck->nb_buffer_events++;
+		ck->buffer_start_time = gf_clock_source_time(ck->compositor);
+	}
 	ck->nb_buffering += 1;
-	gf_mx_v(ck->mx);
+	gf_clock_write_end(ck);
 }
 
 void gf_clock_buffer_off(GF_Clock *ck)
 {
-	gf_mx_p(ck->mx);
-
+	gf_clock_write_begin(ck);
 	if (ck->nb_buffering) {
 		ck->nb_buffering -= 1;
-		if (!ck->nb_buffering)
-			gf_clock_resume(ck);
+		if (!ck->nb_buffering) {
+			ck->buffering_time += gf_clock_source_time(ck->compositor) - ck->buffer_start_time;
+			gf_clock_resume_locked(ck);
+		}
 	}
-	gf_mx_v(ck->mx);
+	gf_clock_write_end(ck);
 }
 
 
 void gf_clock_set_speed(GF_Clock *ck, Fixed speed)
 {
-	u32 time;
+	u32 time, ck_time;
+	u64 time_us, ck_time_us, init_us;
 	if (speed==ck->speed) return;
-	time = gf_sc_get_clock(ck->compositor);
+	gf_clock_write_begin(ck);
+	time = gf_clock_source_time(ck->compositor);
+	time_us = gf_clock_source_time_us(ck->compositor);
 	/*adjust start time*/
-	ck->speed_set_time = gf_clock_time(ck) - ck->init_timestamp;
+	ck_time = gf_clock_real_time_nolock(ck);
+	ck_time_us = gf_clock_real_time_us_nolock(ck);
+	if ((ck->audio_delay>0) && (ck_time < (u32) ck->audio_delay)) {
+		ck_time = 0;
+		ck_time_us = 0;
+	} else {
+		ck_time -= ck->audio_delay;
+		ck_time_us -= (s64) ck->audio_delay * 1000;
+	}
+	ck->speed_set_time = ck_time - ck->init_timestamp;
+	init_us = ((u64) ck->init_ts_loops * 0xFFFFFFFFUL + ck->init_timestamp) * 1000;
+	ck->speed_set_time_us = (s64) ck_time_us - (s64) init_us;
 	ck->pause_time = ck->start_time = time;
+	ck->pause_time_us = ck->start_time_us = time_us;
 	ck->speed = speed;
+	gf_clock_write_end(ck);
+}
+
+void gf_clock_add_au_lateness(GF_Clock *ck, s32 diff)
+{
+	if (!ck) return;
+	ck->nb_aus++;
+	if (diff>=0) return;
+	ck->nb_late_aus++;
+	ck->total_lateness += (u32) -diff;
+	if ((u32) -diff > ck->max_lateness) ck->max_lateness = (u32) -diff;
+}
+
+void gf_clock_get_stats(GF_Clock *ck, GF_ClockStats *stats)
+{
+	memset(stats, 0, sizeof(GF_ClockStats));
+	if (!ck) return;
+	stats->nb_buffer_events = ck->nb_buffer_events;
+	stats->buffering_time = ck->buffering_time;
+	stats->paused_time = ck->paused_time;
+	//account for current buffering and pause
+	if (ck->nb_buffering)
+		stats->buffering_time += gf_clock_source_time(ck->compositor) - ck->buffer_start_time;
+	if (ck->nb_paused)
+		stats->paused_time += gf_clock_source_time(ck->compositor) - ck->pause_time;
+	stats->nb_aus = ck->nb_aus;
+	stats->nb_late_aus = ck->nb_late_aus;
+	stats->max_lateness = ck->max_lateness;
+	stats->avg_lateness = ck->nb_late_aus ? (u32) (ck->total_lateness / ck->nb_late_aus) : 0;
 }
 
 void gf_clock_set_audio_delay(GF_Clock *ck, s32 ms_delay)
@@ -299,15 +560,79 @@ void gf_clock_set_audio_delay(GF_Clock *ck, s32 ms_delay)
 	if (ck) ck->audio_delay = ms_delay;
 }
 
-u32 gf_timestamp_to_clocktime(u64 ts, u32 timescale)
+u64 gf_timestamp_to_clocktime_us(u64 ts, u32 timescale)
 {
 	if (ts==GF_FILTER_NO_TS) return 0;
 	//this happens for direct file loaders calling this (btplay & co)
 	if (!timescale) return 0;
 
-	ts = gf_timestamp_rescale(ts, timescale, 1000);
-	ts = ts % 0xFFFFFFFFUL;
-	return (u32) ts;
+	return gf_timestamp_rescale(ts, timescale, 1000000);
+}
+
+static u64 gf_ts_gcd(u64 a, u64 b)
+{
+	while (b) {
+		u64 t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+//high 64 bits of the 128-bit product
+static u64 gf_ts_mulhi(u64 a, u64 b)
+{
+	u64 a_lo = (u32) a, a_hi = a>>32;
+	u64 b_lo = (u32) b, b_hi = b>>32;
+	u64 p0 = a_lo * b_lo;
+	u64 p1 = a_lo * b_hi;
+	u64 p2 = a_hi * b_lo;
+	u64 p3 = a_hi * b_hi;
+	u64 mid = (p0>>32) + (u32) p1 + (u32) p2;
+	return p3 + (p1>>32) + (p2>>32) + (mid>>32);
+}
+
+void gf_timestamp_rescaler_init(GF_TimestampRescaler *tsr, u32 timescale)
+{
+	u64 g;
+	memset(tsr, 0, sizeof(GF_TimestampRescaler));
+	tsr->timescale = timescale;
+	if (!timescale) return;
+	g = gf_ts_gcd(1000000, timescale);
+	tsr->num = 1000000 / g;
+	tsr->den = timescale / g;
+	tsr->max_ts = 0xFFFFFFFFFFFFFFFFULL / tsr->num;
+	if (tsr->den>1)
+		tsr->recip = 0xFFFFFFFFFFFFFFFFULL / tsr->den;
+}
+
+u64 gf_timestamp_rescaler_to_us(GF_TimestampRescaler *tsr, u64 ts)
+{
+	u64 q, r;
+	if (ts==GF_FILTER_NO_TS) return 0;
+	if (!tsr->timescale) return 0;
+	//product would overflow, use safe rescale
+	if (ts > tsr->max_ts)
+		return gf_timestamp_rescale(ts, tsr->timescale, 1000000);
+
+	ts *= tsr->num;
+	//timescale divides 1000000 (1000, 1000000, ...)
+	if (tsr->den==1) return ts;
+
+	//the reciprocal estimate is at most a few units below the quotient, correct it
+	q = gf_ts_mulhi(ts, tsr->recip);
+	r = ts - q * tsr->den;
+	while (r >= tsr->den) {
+		q++;
+		r -= tsr->den;
+	}
+	return q;
+}
+
+u32 gf_timestamp_to_clocktime(u64 ts, u32 timescale)
+{
+	u64 ts_ms = gf_timestamp_to_clocktime_us(ts, timescale) / 1000;
+	return (u32) (ts_ms % 0xFFFFFFFFUL);
 }
 
 u64 gf_clock_time_absolute(GF_Clock *ck)
@@ -320,6 +645,44 @@ u64 gf_clock_time_absolute(GF_Clock *ck)
 }
 
 
+u64 gf_clock_time_us(GF_Clock *ck)
+{
+	u32 seq;
+	u64 time;
+	if (!ck->clock_init) return 0;
+	do {
+		seq = gf_clock_read_begin(ck);
+		time = gf_clock_real_time_us_nolock(ck);
+	} while (gf_clock_read_retry(ck, seq));
+	if ((ck->audio_delay>0) && (time < (u64) ck->audio_delay * 1000)) return 0;
+	return time - (s64) ck->audio_delay * 1000;
+}
+
+s64 gf_clock_diff_us(GF_Clock *ck, u64 ck_time_us, u64 ts_us)
+{
+	s64 ts_diff = (s64) ts_us - (s64) ck_time_us;
+	if (ck->speed<0)
+		ts_diff = -ts_diff;
+	return ts_diff;
+}
+
+u32 gf_clock_us_until(GF_Clock *ck, u32 ts)
+{
+	s32 diff;
+	u64 us;
+	//not running, time will not progress until resumed
+	if (!gf_clock_is_started(ck) || !ck->speed) return 0;
+	diff = gf_clock_diff(ck, gf_clock_time(ck), ts);
+	if (diff <= 0) return 0;
+	us = (u64) diff * 1000;
+	//clock time runs at speed times system time
+	if (ck->speed != FIX_ONE) {
+		Fixed speed = ck->speed<0 ? -ck->speed : ck->speed;
+		us = (u64) (us / FIX2FLT(speed));
+	}
+	return (us > 0xFFFFFFFF) ? 0xFFFFFFFF : (u32) us;
+}
+
 s32 gf_clock_diff(GF_Clock *ck, u32 ck_time, u32 ts)
 {
 	s64 ts_diff;
@@ -28,29 +28,433 @@
 #include <gpac/constants.h>
 #include <gpac/compositor.h>
 #include <gpac/internal/compositor_dev.h>
+#include "sys_stats.h"
 
 #if !defined(GPAC_DISABLE_BIFS) && !defined(GPAC_DISABLE_COMPOSITOR)
 
 
+/*AU decoded in memory mode, waiting for its CTS to be applied*/
+typedef struct
+{
+	u32 cts;
+	//CTS on the 64-bit us timeline
+	u64 cts_us;
+	GF_List *coms;
+	//AU size and parsing time, for stats
+	u32 size;
+	u64 parse_us;
+	//packet kept when parsing ahead failed, decoded again at CTS once previous AUs are applied
+	GF_FilterPacket *pck;
+	//RAP flag, and CRC of the AU payload only computed for RAPs in dedup mode
+	Bool is_rap;
+	u32 crc;
+} BIFSDecodedAU;
+
+/*decoder state of a scene namespace, created when the first PID of the namespace is attached*/
 typedef struct
 {
 	GF_BifsDecoder *bifs_dec;
+	//graph the decoder operates on, target of command lists in split mode
+	GF_SceneGraph *graph;
+	//first object manager attached, and its scene
 	GF_ObjectManager *odm;
 	GF_Scene *scene;
+	//headless mode: graph owned by the decoder, no scene nor object manager
+	Bool own_graph;
+} BIFSDecScene;
+
+/*per input PID state, created at PID configure and refreshed at each reconfigure*/
+typedef struct
+{
+	GF_FilterPid *ipid, *opid;
+	//object manager attached to the output PID, set at scene attach
+	GF_ObjectManager *odm;
+	//decoder of the scene the PID is attached to
+	BIFSDecScene *sc;
+	//immediate apply and max hold state
+	GF_SysGate gate;
+	//AUs since stats were last published
+	u32 nb_unpublished;
+	u16 ESID;
+	u32 timescale;
+	//timestamp to clock time conversion, setup for the PID or packet timescale
+	GF_TimestampRescaler tsr;
+	//decoded AUs pending for application in split mode, in decoding order
+	GF_List *decoded_aus;
+	GF_SysStats stats;
+
+	//CTS of random access AUs seen so far, in increasing order
+	u32 *raps;
+	u32 nb_raps, alloc_raps;
+	//seek target in clock time, set at play and cleared once non-seek AUs are received
+	u32 seek_target;
+	Bool in_seek;
+
+	//dedup mode: size and CRC of the last applied RAP, and value of the apply counter of the decoder after it was applied
+	Bool has_last_rap;
+	u32 last_rap_size, last_rap_crc;
+	u64 last_rap_seq;
+	u32 nb_repeats;
+	//number of commands dropped by coalescing
+	u32 nb_coalesced;
+	//resync mode: number of AUs which failed to decode, and set while waiting for a RAP after an error
+	u32 nb_errors;
+	Bool wait_rap;
+	//decoder specific info last configured on the decoder, so that unchanged configs are not parsed again
+	GF_BifsDecoder *dsi_dec;
+	u16 dsi_esid;
+	u32 dsi_codecid, dsi_size, dsi_crc;
+} BIFSDecStream;
+
+typedef struct
+{
+	//options
+	u32 budget, fbudget, lookahead, lookau, immediate, maxhold, srate, catchup, maxau, maxcoms;
+	Bool split, stats, dedup, heap, coalesce, multins, headless, odsync, trim, ctsgroup, resync;
+	char *trace;
+
+	//decoders per scene namespace, only one unless multins is set
+	GF_List *scenes;
 
 	Bool is_playing;
 	GF_FilterPid *out_pid;
+	//index of the first input PID to service at next process, rotated when the budget is exhausted
+	u32 next_pid_idx;
+	//budget left in microseconds at the end of the last process, published as dec_budget_left on the output PIDs
+	u32 budget_left;
+	//number of AUs applied on all inputs, used to detect carousel repeats in dedup mode
+	u64 nb_applied;
+	//heap accounting, registered at first process in heap mode
+	GF_SysHeap mem;
+	//host metrics queries, registered at first process in stats mode
+	GF_SysDecoder metrics;
+	//scheduling trace, opened at first process
+	GF_SysTrace tracer;
 } GF_BIFSDecCtx;
 
-static GF_Err bifs_dec_configure_bifs_dec(GF_BIFSDecCtx *ctx, GF_FilterPid *pid)
+static void bifs_dec_del_au(BIFSDecodedAU *au)
+{
+	u32 i, count = gf_list_count(au->coms);
+	for (i=0; i<count; i++) {
+		GF_Command *com = gf_list_get(au->coms, i);
+		gf_sg_command_del(com);
+	}
+	gf_list_del(au->coms);
+	if (au->pck) gf_filter_pck_unref(au->pck);
+	gf_free(au);
+}
+
+/*gets the field written by a field-level replace that can be coalesced, or NULL
+the target node shall not be observed during AU application (no routes, script bindings or listeners), and the field shall not hold nodes or scripts*/
+static GF_CommandField *bifs_dec_get_coalesce_field(GF_Command *com)
+{
+	GF_CommandField *inf;
+	if ((com->tag != GF_SG_FIELD_REPLACE) && (com->tag != GF_SG_INDEXED_REPLACE)) return NULL;
+	if (!com->node || com->scripts_to_load || com->never_apply) return NULL;
+	if (com->node->sgprivate->interact) return NULL;
+	if (gf_list_count(com->command_fields) != 1) return NULL;
+	inf = gf_list_get(com->command_fields, 0);
+	switch (inf->fieldType) {
+	case GF_SG_VRML_SFNODE:
+	case GF_SG_VRML_MFNODE:
+	case GF_SG_VRML_SFSCRIPT:
+	case GF_SG_VRML_MFSCRIPT:
+	case GF_SG_VRML_SFCOMMANDBUFFER:
+		return NULL;
+	}
+	return inf;
+}
+
+/*returns TRUE if applying the AU may change the scene structure: RAPs, AUs kept unparsed, and any command but a replace of a non-node field
+AUs after such an AU resolve node, route and proto IDs against the graph, and cannot be parsed before it is applied*/
+static Bool bifs_dec_au_is_structural(BIFSDecodedAU *au)
+{
+	u32 i, count;
+	if (au->is_rap || au->pck) return GF_TRUE;
+	count = gf_list_count(au->coms);
+	for (i=0; i<count; i++) {
+		if (!bifs_dec_get_coalesce_field(gf_list_get(au->coms, i))) return GF_TRUE;
+	}
+	return GF_FALSE;
+}
+
+/*drops field-level replaces of the command list superseded by a later replace of the same field in the same AU
+the scan for a superseding command stops at the first command which is not a coalescable replace, so that node creation, deletion
+or route changes in between keep seeing the intermediate values. Returns the number of dropped commands*/
+static u32 bifs_dec_coalesce(GF_List *coms)
+{
+	u32 i, j, count, nb_dropped = 0;
+	count = gf_list_count(coms);
+	for (i=0; i+1<count; i++) {
+		GF_Command *com = gf_list_get(coms, i);
+		GF_CommandField *inf = bifs_dec_get_coalesce_field(com);
+		if (!inf) continue;
+
+		for (j=i+1; j<count; j++) {
+			GF_Command *next = gf_list_get(coms, j);
+			GF_CommandField *next_inf = bifs_dec_get_coalesce_field(next);
+			if (!next_inf) break;
+			if ((next->node != com->node) || (next_inf->fieldIndex != inf->fieldIndex)) continue;
+			//a field replace supersedes any previous write of the field, an indexed replace only a write of the same item
+			if ((next->tag == GF_SG_FIELD_REPLACE) || ((com->tag == GF_SG_INDEXED_REPLACE) && (next_inf->pos == inf->pos))) {
+				gf_list_rem(coms, i);
+				gf_sg_command_del(com);
+				nb_dropped++;
+				count--;
+				i--;
+				break;
+			}
+		}
+	}
+	return nb_dropped;
+}
+
+static void bifs_dec_del_stream(BIFSDecStream *st)
+{
+	while (gf_list_count(st->decoded_aus)) {
+		BIFSDecodedAU *au = gf_list_pop_front(st->decoded_aus);
+		bifs_dec_del_au(au);
+	}
+	gf_list_del(st->decoded_aus);
+	if (st->raps) gf_free(st->raps);
+	gf_free(st);
+}
+
+static void bifs_dec_add_rap(BIFSDecStream *st, u32 cts)
+{
+	u32 lo=0, hi=st->nb_raps;
+	//carousels resend the same RAPs, and we may see them again after a seek
+	while (lo<hi) {
+		u32 mid = (lo+hi)/2;
+		if (st->raps[mid] < cts) lo = mid+1;
+		else hi = mid;
+	}
+	if ((lo<st->nb_raps) && (st->raps[lo]==cts)) return;
+
+	if (st->nb_raps == st->alloc_raps) {
+		st->alloc_raps = st->alloc_raps ? 2*st->alloc_raps : 32;
+		st->raps = gf_realloc(st->raps, sizeof(u32) * st->alloc_raps);
+		if (!st->raps) {
+			st->nb_raps = st->alloc_raps = 0;
+			return;
+		}
+	}
+	if (lo<st->nb_raps)
+		memmove(&st->raps[lo+1], &st->raps[lo], sizeof(u32) * (st->nb_raps - lo));
+	st->raps[lo] = cts;
+	st->nb_raps++;
+}
+
+/*returns the CTS of the last indexed RAP at or before the given time, or 0xFFFFFFFF if none*/
+static u32 bifs_dec_get_rap(BIFSDecStream *st, u32 cts)
+{
+	u32 lo=0, hi=st->nb_raps;
+	while (lo<hi) {
+		u32 mid = (lo+hi)/2;
+		if (st->raps[mid] <= cts) lo = mid+1;
+		else hi = mid;
+	}
+	return lo ? st->raps[lo-1] : 0xFFFFFFFF;
+}
+
+/*checks if an AU is a byte-identical copy of the last applied RAP of the stream; if check_seq is set, the AU is a repeat only if
+no other AU was applied since that RAP, in which case applying it again would not change the scene*/
+static Bool bifs_dec_is_repeat(GF_BIFSDecCtx *ctx, BIFSDecStream *st, u32 size, u32 crc, Bool check_seq)
+{
+	if (!st->has_last_rap) return GF_FALSE;
+	if ((st->last_rap_size != size) || (st->last_rap_crc != crc)) return GF_FALSE;
+	if (check_seq && (st->last_rap_seq != ctx->nb_applied)) return GF_FALSE;
+	return GF_TRUE;
+}
+
+/*returns TRUE if another stream of the scene of the PID has a structural AU pending, due no later than the given CTS*/
+static Bool bifs_dec_has_pending_structural(GF_Filter *filter, BIFSDecStream *st, u64 cts_us)
+{
+	u32 i, j, count = gf_filter_get_ipid_count(filter);
+	for (i=0; i<count; i++) {
+		BIFSDecStream *other = gf_filter_pid_get_udta(gf_filter_get_ipid(filter, i));
+		if (!other || (other == st) || (other->sc != st->sc)) continue;
+		for (j=0; j<gf_list_count(other->decoded_aus); j++) {
+			BIFSDecodedAU *au = gf_list_get(other->decoded_aus, j);
+			if (au->cts_us > cts_us) break;
+			if (bifs_dec_au_is_structural(au)) return GF_TRUE;
+		}
+	}
+	return GF_FALSE;
+}
+
+/*decodes the AU into a command list without touching the scene
+if parsing fails, the packet is kept and decoded at CTS, since the AU may depend on nodes created by AUs not yet applied*/
+static GF_Err bifs_dec_decode_commands(GF_BIFSDecCtx *ctx, GF_Filter *filter, BIFSDecStream *st, GF_FilterPacket *pck, u32 cts, u64 cts_us)
 {
 	GF_Err e;
-	u32 es_id=0;
-	u32 codecid=0;
+	u32 size;
+	const u8 *data;
+	BIFSDecodedAU *au;
+	GF_SAFEALLOC(au, BIFSDecodedAU);
+	if (!au) return GF_OUT_OF_MEM;
+	au->coms = gf_list_new();
+	if (!au->coms) {
+		gf_free(au);
+		return GF_OUT_OF_MEM;
+	}
+	data = gf_filter_pck_get_data(pck, &size);
+	au->cts = cts;
+	au->cts_us = cts_us;
+	au->size = size;
+
+	if (gf_filter_pck_get_sap(pck) != GF_FILTER_SAP_NONE)
+		au->is_rap = GF_TRUE;
+	if (ctx->dedup && au->is_rap) {
+		au->crc = gf_crc_32(data, size);
+		//likely carousel repeat, don't parse it: it is either dropped at CTS or decoded then if other AUs were applied meanwhile
+		if (!gf_list_count(st->decoded_aus) && bifs_dec_is_repeat(ctx, st, size, au->crc, GF_FALSE)) {
+			au->pck = pck;
+			gf_filter_pck_ref(&au->pck);
+			gf_list_add(st->decoded_aus, au);
+			return GF_OK;
+		}
+	}
+	//the graph is shared by all streams of the scene: an earlier structural AU of another stream not yet applied
+	//would make the AU resolve IDs against a stale graph, keep the packet and decode it at CTS
+	if (bifs_dec_has_pending_structural(filter, st, cts_us)) {
+		GF_LOG(GF_LOG_DEBUG, GF_LOG_CODEC, ("[BIFS] #CH%d AU TS %u follows a pending structural AU of another stream, will decode at CTS\n", st->ESID, cts));
+		au->pck = pck;
+		gf_filter_pck_ref(&au->pck);
+		gf_list_add(st->decoded_aus, au);
+		return GF_OK;
+	}
+
+	e = gf_bifs_decode_command_list(st->sc->bifs_dec, st->ESID, (u8 *) data, size, au->coms);
+	//work bound, checked before any command is applied
+	if (!e && ctx->maxcoms && (gf_list_count(au->coms) > ctx->maxcoms)) {
+		GF_LOG(GF_LOG_WARNING, GF_LOG_CODEC, ("[BIFS] #CH%d dropping AU TS %u with %u commands, above max %u\n", st->ESID, cts, gf_list_count(au->coms), ctx->maxcoms));
+		st->stats.nb_dropped++;
+		bifs_dec_del_au(au);
+		return GF_OK;
+	}
+	if (e) {
+		u32 i, count = gf_list_count(au->coms);
+		GF_LOG(GF_LOG_DEBUG, GF_LOG_CODEC, ("[BIFS] #CH%d failed to parse AU TS %u ahead of time (%s), will decode at CTS\n", st->ESID, cts, gf_error_to_string(e)));
+		for (i=0; i<count; i++) {
+			GF_Command *com = gf_list_get(au->coms, i);
+			gf_sg_command_del(com);
+		}
+		gf_list_reset(au->coms);
+		au->pck = pck;
+		gf_filter_pck_ref(&au->pck);
+	}
+	gf_list_add(st->decoded_aus, au);
+	return GF_OK;
+}
+
+/*gets the next packet to decode and its CTS in clock time (ms and 64-bit us), indexing RAPs and dropping AUs made useless by a seek*/
+static GF_FilterPacket *bifs_dec_next_packet(GF_BIFSDecCtx *ctx, BIFSDecStream *st, u32 *cts, u64 *cts_us)
+{
+	while (1) {
+		u64 ts;
+		u32 timescale;
+		GF_FilterPacket *pck = gf_filter_pid_get_packet(st->ipid);
+		if (!pck) return NULL;
+
+		ts = gf_filter_pck_get_cts( pck );
+		timescale = st->timescale ? st->timescale : gf_filter_pck_get_timescale(pck);
+		if (st->tsr.timescale != timescale) gf_timestamp_rescaler_init(&st->tsr, timescale);
+		*cts_us = gf_timestamp_rescaler_to_us(&st->tsr, ts);
+		*cts = (u32) ((*cts_us / 1000) % 0xFFFFFFFFUL);
+
+		//work bound: an AU too large is likely corrupted or hostile, don't let it stall the main thread
+		if (ctx->maxau) {
+			u32 size;
+			gf_filter_pck_get_data(pck, &size);
+			if (size > ctx->maxau) {
+				GF_LOG(GF_LOG_WARNING, GF_LOG_CODEC, ("[BIFS] #CH%d dropping AU TS %u of %u bytes, above max AU size %u\n", st->ESID, *cts, size, ctx->maxau));
+				st->stats.nb_dropped++;
+				gf_filter_pid_drop_packet(st->ipid);
+				continue;
+			}
+		}
+
+		if (gf_filter_pck_get_sap(pck) != GF_FILTER_SAP_NONE) {
+			bifs_dec_add_rap(st, *cts);
+		}
+		//seek fast path: an AU before the seek target is useless if a RAP between this AU and the target is known,
+		//since the RAP will replace the scene before the target is reached
+		//not done in headless mode, where every AU produces its output packet
+		else if (st->in_seek && !ctx->headless && gf_filter_pck_get_seek_flag(pck)) {
+			u32 rap = bifs_dec_get_rap(st, st->seek_target);
+			if ((rap != 0xFFFFFFFF) && (rap > *cts)) {
+				GF_LOG(GF_LOG_DEBUG, GF_LOG_CODEC, ("[BIFS] #CH%d skipping AU TS %u during seek, RAP at %u\n", st->ESID, *cts, rap));
+				st->stats.nb_dropped++;
+				gf_filter_pid_drop_packet(st->ipid);
+				continue;
+			}
+		}
+		if (st->in_seek && !gf_filter_pck_get_seek_flag(pck))
+			st->in_seek = GF_FALSE;
+		return pck;
+	}
+}
+
+/*parse stage of split mode: parse AUs ahead of time, within the lookahead AU count and time window*/
+static GF_Err bifs_dec_parse_ahead(GF_BIFSDecCtx *ctx, GF_Filter *filter, BIFSDecStream *st, Bool do_timing)
+{
+	u32 max_aus = ctx->lookau ? ctx->lookau : 1;
+	while (gf_list_count(st->decoded_aus) < max_aus) {
+		GF_Err e;
+		u32 cts;
+		u64 now = 0, cts_us;
+		BIFSDecodedAU *au = gf_list_last(st->decoded_aus);
+		GF_FilterPacket *pck;
+
+		//stop at the first pending AU changing the scene structure, later AUs are parsed once it is applied
+		if (au && bifs_dec_au_is_structural(au)) break;
+
+		pck = bifs_dec_next_packet(ctx, st, &cts, &cts_us);
+		if (!pck) break;
+
+		//always parse the next AU, only parse further ones if within the time window
+		if (ctx->lookahead && gf_list_count(st->decoded_aus)) {
+			u32 ref_time;
+			if (st->odm->ck->clock_init) {
+				ref_time = gf_clock_time(st->odm->ck);
+			} else {
+				BIFSDecodedAU *first = gf_list_get(st->decoded_aus, 0);
+				ref_time = first->cts;
+			}
+			if (gf_clock_diff(st->odm->ck, ref_time, cts) > (s32) ctx->lookahead)
+				break;
+		}
+
+		if (do_timing) now = gf_sys_clock_high_res();
+		e = bifs_dec_decode_commands(ctx, filter, st, pck, cts, cts_us);
+		if (do_timing) now = gf_sys_clock_high_res() - now;
+		gf_filter_pid_drop_packet(st->ipid);
+		if (e) return e;
+
+		GF_LOG(GF_LOG_DEBUG, GF_LOG_CODEC, ("[BIFS] ODM%d #CH%d parsed AU TS %u in "LLU" us\n", st->odm->ID, st->ESID, cts, now));
+		au = gf_list_last(st->decoded_aus);
+		au->parse_us = now;
+	}
+	return GF_OK;
+}
+
+static GF_Err bifs_dec_configure_bifs_dec(GF_BIFSDecCtx *ctx, BIFSDecStream *st)
+{
+	GF_Err e;
+	u32 codecid=0, crc;
 	const GF_PropertyValue *prop;
+	BIFSDecScene *sc;
+	GF_FilterPid *pid = st->ipid;
 
+	//refresh cached PID state, invalidated by any reconfigure
+	st->ESID = 0;
 	prop = gf_filter_pid_get_property(pid, GF_PROP_PID_ID);
-	if (prop) es_id = prop->value.uint;
+	if (prop) st->ESID = prop->value.uint;
+	st->timescale = 0;
+	prop = gf_filter_pid_get_property(pid, GF_PROP_PID_TIMESCALE);
+	if (prop) st->timescale = prop->value.uint;
+	sys_gate_setup(&st->gate, pid, ctx->immediate);
 
 	prop = gf_filter_pid_get_property(pid, GF_PROP_PID_CODECID);
 	if (prop) codecid = prop->value.uint;
@@ -62,27 +466,76 @@ static GF_Err bifs_dec_configure_bifs_dec(GF_BIFSDecCtx *ctx, GF_FilterPid *pid)
 		return GF_NON_COMPLIANT_BITSTREAM;
 	}
 
-	if (!ctx->bifs_dec) {
+	sc = st->sc;
+	if (!sc->bifs_dec) {
+		//decoder released at EOS, recreate it on the same graph
+		if (sc->graph) {
+			sc->bifs_dec = gf_bifs_decoder_new(sc->graph, (sc->scene && (sc->graph != sc->scene->graph)) ? GF_TRUE : GF_FALSE);
+		}
 		/*if a node asked for this media object, use the scene graph of the node (AnimationStream in PROTO)*/
-		if (ctx->odm->mo && ctx->odm->mo->node_ptr) {
-			GF_SceneGraph *sg = gf_node_get_graph((GF_Node*)ctx->odm->mo->node_ptr);
-			ctx->bifs_dec = gf_bifs_decoder_new(sg, GF_TRUE);
-			ctx->odm->mo->node_ptr = NULL;
+		else if (sc->odm->mo && sc->odm->mo->node_ptr) {
+			GF_SceneGraph *sg = gf_node_get_graph((GF_Node*)sc->odm->mo->node_ptr);
+			sc->bifs_dec = gf_bifs_decoder_new(sg, GF_TRUE);
+			sc->graph = sg;
+			sc->odm->mo->node_ptr = NULL;
 		} else {
-			ctx->bifs_dec = gf_bifs_decoder_new(ctx->scene->graph, GF_FALSE);
+			sc->bifs_dec = gf_bifs_decoder_new(sc->scene->graph, GF_FALSE);
+			sc->graph = sc->scene->graph;
 		}
 	}
 
 
-	e = gf_bifs_decoder_configure_stream(ctx->bifs_dec, es_id, prop->value.data.ptr, prop->value.data.size, codecid);
-	if (e) return e;
+	//typically a period or track switch with the same stream
+	crc = gf_crc_32(prop->value.data.ptr, prop->value.data.size);
+	if ((st->dsi_dec == sc->bifs_dec) && (st->dsi_esid == st->ESID) && (st->dsi_codecid == codecid)
+		&& (st->dsi_size == prop->value.data.size) && (st->dsi_crc == crc)
+	) {
+		GF_LOG(GF_LOG_DEBUG, GF_LOG_CODEC, ("[BIFS] #CH%d decoder config unchanged, not reconfiguring\n", st->ESID));
+		return GF_OK;
+	}
+
+	e = gf_bifs_decoder_configure_stream(sc->bifs_dec, st->ESID, prop->value.data.ptr, prop->value.data.size, codecid);
+	if (e) {
+		st->dsi_dec = NULL;
+		return e;
+	}
+	st->dsi_dec = sc->bifs_dec;
+	st->dsi_esid = st->ESID;
+	st->dsi_codecid = codecid;
+	st->dsi_size = prop->value.data.size;
+	st->dsi_crc = crc;
 
 	return GF_OK;
 }
 
+/*gets the decoder of headless mode, shared by all PIDs and decoding into a graph owned by the filter*/
+static BIFSDecScene *bifs_dec_get_headless_scene(GF_BIFSDecCtx *ctx)
+{
+	BIFSDecScene *sc;
+	if (!ctx->scenes) {
+		ctx->scenes = gf_list_new();
+		if (!ctx->scenes) return NULL;
+	}
+	sc = gf_list_get(ctx->scenes, 0);
+	if (sc) return sc;
+
+	GF_SAFEALLOC(sc, BIFSDecScene);
+	if (!sc) return NULL;
+	sc->graph = gf_sg_new();
+	if (sc->graph) sc->bifs_dec = gf_bifs_decoder_new(sc->graph, GF_TRUE);
+	if (!sc->bifs_dec) {
+		if (sc->graph) gf_sg_del(sc->graph);
+		gf_free(sc);
+		return NULL;
+	}
+	sc->own_graph = GF_TRUE;
+	gf_list_add(ctx->scenes, sc);
+	return sc;
+}
+
 GF_Err bifs_dec_configure_pid(GF_Filter *filter, GF_FilterPid *pid, Bool is_remove)
 {
-	GF_FilterPid *out_pid;
+	BIFSDecStream *st;
 	GF_BIFSDecCtx *ctx = gf_filter_get_udta(filter);
 	const GF_PropertyValue *prop;
 
@@ -101,121 +554,639 @@ GF_Err bifs_dec_configure_pid(GF_Filter *filter, GF_FilterPid *pid, Bool is_remo
 		return GF_NON_COMPLIANT_BITSTREAM;
 	}
 
+	st = gf_filter_pid_get_udta(pid);
 	if (is_remove) {
-		out_pid = gf_filter_pid_get_udta(pid);
-		if (ctx->out_pid==out_pid)
-			ctx->out_pid = NULL;
-		if (out_pid)
-			gf_filter_pid_remove(out_pid);
+		if (st) {
+			if (ctx->out_pid==st->opid)
+				ctx->out_pid = NULL;
+			if (st->opid)
+				gf_filter_pid_remove(st->opid);
+			gf_filter_pid_set_udta(pid, NULL);
+			bifs_dec_del_stream(st);
+		}
 		return GF_OK;
 	}
 	//this is a reconfigure
-	if (gf_filter_pid_get_udta(pid)) {
-		return bifs_dec_configure_bifs_dec(ctx, pid);
+	if (st) {
+		//no decoder yet (scene not attached), state will be refreshed at attach time
+		if (!st->sc) return GF_OK;
+		return bifs_dec_configure_bifs_dec(ctx, st);
 	}
 
-	//check our namespace
-	if (ctx->scene && ! gf_filter_pid_is_filter_in_parents(pid, ctx->scene->root_od->scene_ns->source_filter)) {
-		return GF_REQUIRES_NEW_INSTANCE;
+	//check our namespace, unless we handle several of them
+	if (!ctx->multins) {
+		BIFSDecScene *sc = gf_list_get(ctx->scenes, 0);
+		if (sc && sc->scene && ! gf_filter_pid_is_filter_in_parents(pid, sc->scene->root_od->scene_ns->source_filter)) {
+			return GF_REQUIRES_NEW_INSTANCE;
+		}
 	}
 
 
+	GF_SAFEALLOC(st, BIFSDecStream);
+	if (!st) return GF_OUT_OF_MEM;
+	st->ipid = pid;
+	st->decoded_aus = gf_list_new();
+	if (!st->decoded_aus) {
+		gf_free(st);
+		return GF_OUT_OF_MEM;
+	}
+
 	//declare a new output PID of type SCENE, codecid RAW
-	out_pid = gf_filter_pid_new(filter);
+	st->opid = gf_filter_pid_new(filter);
 
 	//copy properties at init or reconfig
-	gf_filter_pid_copy_properties(out_pid, pid);
-	gf_filter_pid_set_property(out_pid, GF_PROP_PID_CODECID, &PROP_UINT(GF_CODECID_RAW) );
-	gf_filter_pid_set_udta(pid, out_pid);
+	gf_filter_pid_copy_properties(st->opid, pid);
+	gf_filter_pid_set_property(st->opid, GF_PROP_PID_CODECID, &PROP_UINT(GF_CODECID_RAW) );
+	gf_filter_pid_set_udta(pid, st);
 
 	if (!ctx->out_pid)
-		ctx->out_pid = out_pid;
+		ctx->out_pid = st->opid;
+
+	//no compositor in headless mode, the decoder is setup right away
+	if (ctx->headless) {
+		st->sc = bifs_dec_get_headless_scene(ctx);
+		if (!st->sc) return GF_OUT_OF_MEM;
+		return bifs_dec_configure_bifs_dec(ctx, st);
+	}
 	return GF_OK;
 }
 
 
 
-GF_Err bifs_dec_process(GF_Filter *filter)
+/*metrics query callback: merges stats of all input streams, the clock is the one of the first attached stream*/
+static void bifs_dec_get_stats(void *owner, GF_SysStats *stats, GF_Clock **ck)
+{
+	u32 i, count;
+	GF_Filter *filter = (GF_Filter *) owner;
+	count = gf_filter_get_ipid_count(filter);
+	for (i=0; i<count; i++) {
+		GF_FilterPid *pid = gf_filter_get_ipid(filter, i);
+		BIFSDecStream *st = gf_filter_pid_get_udta(pid);
+		if (!st) continue;
+		sys_stats_merge(stats, &st->stats);
+		if (!*ck && st->odm) *ck = st->odm->ck;
+	}
+}
+
+/*writes the summary of a decoded command list: for each command, tag (u8), target node ID (u32, 0 if none), number of fields (u16)
+then for each field its index (u16), type (u8) and position (s32)*/
+static void bifs_dec_write_coms(GF_BitStream *bs, GF_List *coms)
+{
+	u32 i, j, count, nb_fields;
+	count = gf_list_count(coms);
+	for (i=0; i<count; i++) {
+		GF_Command *com = gf_list_get(coms, i);
+		nb_fields = gf_list_count(com->command_fields);
+		gf_bs_write_u8(bs, com->tag);
+		gf_bs_write_u32(bs, com->node ? gf_node_get_id(com->node) : 0);
+		gf_bs_write_u16(bs, nb_fields);
+		for (j=0; j<nb_fields; j++) {
+			GF_CommandField *inf = gf_list_get(com->command_fields, j);
+			gf_bs_write_u16(bs, inf->fieldIndex);
+			gf_bs_write_u8(bs, inf->fieldType);
+			gf_bs_write_u32(bs, (u32) inf->pos);
+		}
+	}
+}
+
+/*headless mode: decodes all available AUs without timing into command lists, applies them to the graph owned by the filter
+and sends the command list summary as an output packet*/
+static GF_Err bifs_dec_process_headless(GF_Filter *filter)
+{
+	u32 i, count;
+	GF_BIFSDecCtx *ctx = gf_filter_get_udta(filter);
+
+	count = gf_filter_get_ipid_count(filter);
+	for (i=0; i<count; i++) {
+		GF_FilterPid *pid = gf_filter_get_ipid(filter, i);
+		BIFSDecStream *st = gf_filter_pid_get_udta(pid);
+		if (!st || !st->sc) continue;
+
+		while (1) {
+			GF_Err e;
+			u32 j, size, out_size, cts;
+			u64 cts_us, now = 0;
+			const u8 *data;
+			u8 *output, *buf;
+			GF_BitStream *bs;
+			GF_FilterPacket *pck_out;
+			GF_List *coms;
+			GF_FilterPacket *pck = bifs_dec_next_packet(ctx, st, &cts, &cts_us);
+			if (!pck) {
+				if (gf_filter_pid_is_eos(pid)) {
+					if (ctx->stats) sys_stats_publish(&st->stats, st->opid);
+					gf_filter_pid_set_eos(st->opid);
+				}
+				break;
+			}
+			data = gf_filter_pck_get_data(pck, &size);
+			coms = gf_list_new();
+			if (!coms) return GF_OUT_OF_MEM;
+
+			if (ctx->stats) now = gf_sys_clock_high_res();
+			e = gf_bifs_decode_command_list(st->sc->bifs_dec, st->ESID, (u8 *) data, size, coms);
+			//apply to our graph so that nodes and protos used by next AUs are known
+			if (!e) e = gf_sg_command_apply_list(st->sc->graph, coms, ((Double) cts_us) / 1000000.0);
+			if (ctx->stats) {
+				sys_stats_add(&st->stats, size, gf_sys_clock_high_res() - now);
+				if (sys_stats_sample(&st->nb_unpublished, ctx->srate))
+					sys_stats_publish(&st->stats, st->opid);
+			}
+
+			bs = gf_bs_new(NULL, 0, GF_BITSTREAM_WRITE);
+			if (bs) {
+				bifs_dec_write_coms(bs, coms);
+				buf = NULL;
+				out_size = 0;
+				gf_bs_get_content(bs, &buf, &out_size);
+				gf_bs_del(bs);
+				pck_out = buf ? gf_filter_pck_new_alloc(st->opid, out_size, &output) : NULL;
+				if (pck_out) {
+					memcpy(output, buf, out_size);
+					gf_filter_pck_merge_properties(pck, pck_out);
+					gf_filter_pck_send(pck_out);
+				}
+				if (buf) gf_free(buf);
+			}
+			for (j=0; j<gf_list_count(coms); j++) {
+				gf_sg_command_del(gf_list_get(coms, j));
+			}
+			gf_list_del(coms);
+			gf_filter_pid_drop_packet(pid);
+
+			if (e) {
+				GF_LOG(GF_LOG_WARNING, GF_LOG_CODEC, ("[BIFS] #CH%d failed to decode AU TS %u: %s\n", st->ESID, cts, gf_error_to_string(e)));
+			}
+		}
+	}
+	return GF_OK;
+}
+
+/*catch-up mode: once the head AU is late by more than the catchup time, pulls all due AUs out of the PID and drops the ones
+preceding the last due RAP, since the RAP replaces the scene they update. Pulled AUs are decoded at CTS as AUs that failed to parse ahead*/
+static GF_Err bifs_dec_catchup(GF_BIFSDecCtx *ctx, BIFSDecStream *st)
+{
+	u32 i, count, last_rap = 0;
+	u64 ck_us;
+	GF_Clock *ck = st->odm->ck;
+	BIFSDecodedAU *au = gf_list_get(st->decoded_aus, 0);
+
+	if (!ck->clock_init || ck->nb_paused) return GF_OK;
+	ck_us = gf_clock_time_us(ck);
+	if (au) {
+		if (gf_clock_diff_us(ck, ck_us, au->cts_us) > - (s64) ctx->catchup * 1000) return GF_OK;
+	} else {
+		u32 cts;
+		u64 cts_us;
+		if (!bifs_dec_next_packet(ctx, st, &cts, &cts_us)) return GF_OK;
+		if (gf_clock_diff_us(ck, ck_us, cts_us) > - (s64) ctx->catchup * 1000) return GF_OK;
+	}
+
+	while (1) {
+		u32 cts, size;
+		u64 cts_us;
+		GF_FilterPacket *pck = bifs_dec_next_packet(ctx, st, &cts, &cts_us);
+		if (!pck || (gf_clock_diff_us(ck, ck_us, cts_us) > 0)) break;
+
+		GF_SAFEALLOC(au, BIFSDecodedAU);
+		if (!au) return GF_OUT_OF_MEM;
+		au->cts = cts;
+		au->cts_us = cts_us;
+		au->pck = pck;
+		gf_filter_pck_ref(&au->pck);
+		gf_filter_pck_get_data(pck, &size);
+		au->size = size;
+		if (gf_filter_pck_get_sap(pck) != GF_FILTER_SAP_NONE) {
+			au->is_rap = GF_TRUE;
+			if (ctx->dedup) au->crc = gf_crc_32(gf_filter_pck_get_data(pck, &size), size);
+		}
+		gf_list_add(st->decoded_aus, au);
+		gf_filter_pid_drop_packet(st->ipid);
+	}
+
+	count = gf_list_count(st->decoded_aus);
+	for (i=1; i<count; i++) {
+		au = gf_list_get(st->decoded_aus, i);
+		if (gf_clock_diff_us(ck, ck_us, au->cts_us) > 0) break;
+		if (au->is_rap) last_rap = i;
+	}
+	if (!last_rap) return GF_OK;
+
+	GF_LOG(GF_LOG_INFO, GF_LOG_CODEC, ("[BIFS] #CH%d late by more than %u ms, dropping %u AUs before RAP TS %u\n", st->ESID, ctx->catchup, last_rap, ((BIFSDecodedAU *) gf_list_get(st->decoded_aus, last_rap))->cts));
+	for (i=0; i<last_rap; i++) {
+		au = gf_list_pop_front(st->decoded_aus);
+		st->stats.nb_dropped++;
+		sys_trace_write(&ctx->tracer, SYS_TRACE_DROPPED, st->ESID, ck, au->cts_us, 0);
+		if (ctx->heap) sys_heap_begin(&ctx->mem);
+		bifs_dec_del_au(au);
+		if (ctx->heap) sys_heap_end(&ctx->mem, SYS_HEAP_COMS);
+	}
+	return GF_OK;
+}
+
+/*returns TRUE if the next AU of the stream has the given CTS*/
+static Bool bifs_dec_next_at(GF_BIFSDecCtx *ctx, BIFSDecStream *st, u64 cts_us)
+{
+	u32 cts;
+	u64 next_us;
+	BIFSDecodedAU *au = gf_list_get(st->decoded_aus, 0);
+	if (au) return (au->cts_us == cts_us) ? GF_TRUE : GF_FALSE;
+	if (!bifs_dec_next_packet(ctx, st, &cts, &next_us)) return GF_FALSE;
+	return (next_us == cts_us) ? GF_TRUE : GF_FALSE;
+}
+
+/*releases the decoder of a scene once all its streams are done, unless conditionals may still use it*/
+static void bifs_dec_trim(GF_Filter *filter, BIFSDecScene *sc)
+{
+	u32 i, count = gf_filter_get_ipid_count(filter);
+	if (!sc->bifs_dec || gf_bifs_decode_has_conditionnals(sc->bifs_dec)) return;
+	for (i=0; i<count; i++) {
+		GF_FilterPid *pid = gf_filter_get_ipid(filter, i);
+		BIFSDecStream *st = gf_filter_pid_get_udta(pid);
+		if (!st || (st->sc != sc)) continue;
+		if (!gf_filter_pid_is_eos(pid) || gf_filter_pid_get_packet(pid) || gf_list_count(st->decoded_aus)) return;
+	}
+	for (i=0; i<count; i++) {
+		BIFSDecStream *st = gf_filter_pid_get_udta(gf_filter_get_ipid(filter, i));
+		if (st && (st->sc == sc)) st->dsi_dec = NULL;
+	}
+	GF_LOG(GF_LOG_DEBUG, GF_LOG_CODEC, ("[BIFS] All streams done, releasing decoder\n"));
+	gf_bifs_decoder_del(sc->bifs_dec);
+	sc->bifs_dec = NULL;
+}
+
+/*recreates the decoder of a scene released at EOS and configures all its streams*/
+static GF_Err bifs_dec_restore(GF_BIFSDecCtx *ctx, GF_Filter *filter, BIFSDecScene *sc)
+{
+	u32 i, count = gf_filter_get_ipid_count(filter);
+	for (i=0; i<count; i++) {
+		GF_Err e;
+		BIFSDecStream *st = gf_filter_pid_get_udta(gf_filter_get_ipid(filter, i));
+		if (!st || (st->sc != sc)) continue;
+		e = bifs_dec_configure_bifs_dec(ctx, st);
+		if (e) return e;
+	}
+	return GF_OK;
+}
+
+static GF_Err bifs_dec_process_aus(GF_Filter *filter)
 {
 	GF_Err e;
 	Double ts_offset;
-	u64 now, cts;
+	u64 now, start_time=0;
 	u32 i, count;
-	const char *data;
-	u32 size, ESID=0;
-	const GF_PropertyValue *prop;
+	const u8 *data;
+	u32 size;
+	Bool budget_over = GF_FALSE;
+	Bool do_timing, in_group;
+	u32 next_due_us = 0;
 	GF_FilterPacket *pck;
 	GF_BIFSDecCtx *ctx = gf_filter_get_udta(filter);
 
-	GF_Scene *scene = ctx->scene;
+	if (ctx->headless) return bifs_dec_process_headless(filter);
 
-	if (!scene) {
+	//no scene attached, hence no decoder
+	if (!gf_list_count(ctx->scenes)) {
 		if (ctx->is_playing) {
-			if (ctx->out_pid && gf_bifs_decode_has_conditionnals(ctx->bifs_dec)) {
-				gf_filter_pid_set_info(ctx->out_pid, GF_PROP_PID_KEEP_AFTER_EOS, &PROP_BOOL(GF_TRUE));
-			}
 			gf_filter_pid_set_eos(ctx->out_pid);
 			return GF_EOS;
 		}
 		return GF_OK;
 	}
-	if (!ctx->bifs_dec) return GF_OK;
+	if (ctx->heap && !ctx->mem.owner) sys_heap_register(&ctx->mem, "bifsdec", filter);
+	if (ctx->stats && !ctx->metrics.owner) {
+		ctx->metrics.name = "bifsdec";
+		ctx->metrics.owner = filter;
+		ctx->metrics.get_stats = bifs_dec_get_stats;
+		ctx->metrics.heap = ctx->heap ? &ctx->mem : NULL;
+		sys_metrics_register(&ctx->metrics);
+	}
+	if (ctx->trace && !ctx->tracer.opened) sys_trace_open(&ctx->tracer, ctx->trace, "bifsdec");
+
+	if (ctx->budget) start_time = gf_sys_clock_high_res();
+	//only sample decode times when needed
+	do_timing = (ctx->stats || ctx->fbudget || ctx->tracer.bs || gf_log_tool_level_on(GF_LOG_CODEC, GF_LOG_DEBUG)) ? GF_TRUE : GF_FALSE;
+	now = 0;
 
 	count = gf_filter_get_ipid_count(filter);
+	if (ctx->next_pid_idx >= count) ctx->next_pid_idx = 0;
+
 	for (i=0; i<count; i++) {
-		GF_FilterPid *pid = gf_filter_get_ipid(filter, i);
-		GF_FilterPid *opid = gf_filter_pid_get_udta(pid);
-
-		GF_ObjectManager *odm = gf_filter_pid_get_udta(opid);
-		//object clock shall be valid
-		if (!odm || !odm->ck) continue;
-
-		pck = gf_filter_pid_get_packet(pid);
-		if (!pck) {
-			Bool is_eos = gf_filter_pid_is_eos(pid);
-			if (is_eos) {
-				if (opid && gf_bifs_decode_has_conditionnals(ctx->bifs_dec)) {
-					gf_filter_pid_set_info(opid, GF_PROP_PID_KEEP_AFTER_EOS, &PROP_BOOL(GF_TRUE));
+		u32 pid_idx = (ctx->next_pid_idx + i) % count;
+		GF_FilterPid *pid = gf_filter_get_ipid(filter, pid_idx);
+		BIFSDecStream *st = gf_filter_pid_get_udta(pid);
+		GF_ObjectManager *odm = st ? st->odm : NULL;
+		GF_Scene *scene;
+		//decoder released at EOS, restore it once new AUs are received
+		if (odm && st->sc && !st->sc->bifs_dec && st->sc->graph && gf_filter_pid_get_packet(pid)) {
+			e = bifs_dec_restore(ctx, filter, st->sc);
+			if (e) return e;
+		}
+		//object clock and decoder shall be valid
+		if (!odm || !odm->ck || !st->sc || !st->sc->bifs_dec) continue;
+		scene = st->sc->scene;
+
+		if (ctx->catchup) {
+			e = bifs_dec_catchup(ctx, st);
+			if (e) return e;
+		}
+
+		//AUs with the same CTS are applied in the same call, without yielding in between
+		in_group = GF_FALSE;
+		//in drain mode, decode all due AUs of this PID until budget is exhausted
+		while (1) {
+			u32 cts = 0;
+			u64 cts_us = 0;
+			Bool is_rap = GF_FALSE, is_repeat = GF_FALSE, is_due, do_publish;
+			u32 crc = 0;
+			BIFSDecodedAU *au = NULL;
+			pck = NULL;
+
+			if (ctx->split) {
+				if (ctx->heap) sys_heap_begin(&ctx->mem);
+				e = bifs_dec_parse_ahead(ctx, filter, st, do_timing);
+				if (ctx->heap) sys_heap_end(&ctx->mem, SYS_HEAP_COMS);
+				if (e) return e;
+				au = gf_list_get(st->decoded_aus, 0);
+				if (au) {
+					cts = au->cts;
+					cts_us = au->cts_us;
 				}
-				gf_filter_pid_set_eos(opid);
+			} else if (gf_list_count(st->decoded_aus)) {
+				//AUs pulled from the PID in catch-up mode
+				au = gf_list_get(st->decoded_aus, 0);
+				cts = au->cts;
+				cts_us = au->cts_us;
+			} else {
+				pck = bifs_dec_next_packet(ctx, st, &cts, &cts_us);
+			}
+			if (!au && !pck) {
+				if (gf_filter_pid_is_eos(pid)) {
+					if (gf_bifs_decode_has_conditionnals(st->sc->bifs_dec)) {
+						gf_filter_pid_set_info(st->opid, GF_PROP_PID_KEEP_AFTER_EOS, &PROP_BOOL(GF_TRUE));
+					}
+					if (ctx->stats) sys_stats_publish(&st->stats, st->opid);
+					gf_filter_pid_set_eos(st->opid);
+					if (ctx->trim) bifs_dec_trim(filter, st->sc);
+				}
+				break;
+			}
+
+			//AUs following a decoding error are dropped until a RAP replaces the scene
+			if (st->wait_rap) {
+				if (au ? !au->is_rap : (gf_filter_pck_get_sap(pck) == GF_FILTER_SAP_NONE)) {
+					GF_LOG(GF_LOG_DEBUG, GF_LOG_CODEC, ("[BIFS] ODM%d #CH%d dropping AU TS %u, waiting for RAP\n", odm->ID, st->ESID, cts));
+					st->stats.nb_dropped++;
+					sys_trace_write(&ctx->tracer, SYS_TRACE_DROPPED, st->ESID, odm->ck, cts_us, 0);
+					if (au) {
+						gf_list_rem(st->decoded_aus, 0);
+						bifs_dec_del_au(au);
+					} else {
+						gf_filter_pid_drop_packet(pid);
+					}
+					continue;
+				}
+				GF_LOG(GF_LOG_INFO, GF_LOG_CODEC, ("[BIFS] ODM%d #CH%d resync on RAP TS %u\n", odm->ID, st->ESID, cts));
+				st->wait_rap = GF_FALSE;
+			}
+
+			gf_rmt_begin(gf_sc_check_sys_frame, GF_RMT_AGGREGATE);
+			is_due = gf_sc_check_sys_frame(scene, odm, pid, filter, cts, 0);
+			gf_rmt_end();
+			if (!is_due) {
+				//not yet due, remember when the earliest pending AU will be
+				u32 us, hold_us;
+				st->stats.nb_gated++;
+				sys_trace_write(&ctx->tracer, SYS_TRACE_GATED, st->ESID, odm->ck, cts_us, 0);
+				if (!sys_gate_force(&st->gate, odm->ck, cts_us, ctx->maxhold, &hold_us)) {
+					us = gf_clock_us_until(odm->ck, cts);
+					if (hold_us && (!us || (hold_us < us)))
+						us = hold_us;
+					if (us && (!next_due_us || (us < next_due_us)))
+						next_due_us = us;
+					break;
+				}
+			}
+			sys_gate_reset(&st->gate);
+
+			//shared frame budget exhausted: carry over to the next frame
+			if (ctx->fbudget && !in_group && !sys_budget_left(scene->compositor, ctx->fbudget)) {
+				u32 us = sys_budget_wait_us(scene->compositor);
+				if (!us) us = 1000;
+				if (!next_due_us || (us < next_due_us))
+					next_due_us = us;
+				break;
+			}
+			//OD AUs this AU may depend on are still pending in the OD decoder, retry once it had a chance to run
+			if ((ctx->fbudget || ctx->odsync) && sys_od_barrier_blocks(odm->ck, cts_us)) {
+				if (!next_due_us || (1000 < next_due_us))
+					next_due_us = 1000;
+				break;
 			}
-			continue;
-		}
-		data = gf_filter_pck_get_data(pck, &size);
 
-		prop = gf_filter_pid_get_property(pid, GF_PROP_PID_ID);
-		if (prop) ESID = prop->value.uint;
+			if (ctx->dedup) {
+				if (au) {
+					is_rap = au->is_rap;
+					crc = au->crc;
+					size = au->size;
+				} else if (gf_filter_pck_get_sap(pck) != GF_FILTER_SAP_NONE) {
+					is_rap = GF_TRUE;
+					data = gf_filter_pck_get_data(pck, &size);
+					crc = gf_crc_32(data, size);
+				}
+				if (is_rap)
+					is_repeat = bifs_dec_is_repeat(ctx, st, size, crc, GF_TRUE);
+			}
 
-		cts = gf_filter_pck_get_cts( pck );
-		cts = gf_timestamp_to_clocktime(cts, gf_filter_pck_get_timescale(pck) );
+			sys_trace_write(&ctx->tracer, is_repeat ? SYS_TRACE_DROPPED : SYS_TRACE_DUE, st->ESID, odm->ck, cts_us, 0);
+
+			e = GF_OK;
+			if (is_repeat) {
+				GF_LOG(GF_LOG_DEBUG, GF_LOG_CODEC, ("[BIFS] ODM%d #CH%d dropping AU TS %u, repeat of last applied RAP\n", odm->ID, st->ESID, cts));
+				st->nb_repeats++;
+				gf_filter_pid_set_info_str(st->opid, "dec_repeats", &PROP_UINT(st->nb_repeats) );
+			} else {
+				//keep sub-millisecond precision of the CTS
+				ts_offset = (Double) cts + (Double) (cts_us % 1000) / 1000.0;
+				ts_offset /= 1000.0;
+				if (do_timing) now = gf_sys_clock_high_res();
+				if (ctx->heap) sys_heap_begin(&ctx->mem);
+				if (au && !au->pck) {
+					if (ctx->coalesce) {
+						u32 nb_dropped = bifs_dec_coalesce(au->coms);
+						if (nb_dropped) {
+							st->nb_coalesced += nb_dropped;
+							gf_filter_pid_set_info_str(st->opid, "dec_coalesced", &PROP_UINT(st->nb_coalesced) );
+						}
+					}
+					e = gf_sg_command_apply_list(st->sc->graph, au->coms, ts_offset);
+				} else {
+					data = gf_filter_pck_get_data(au ? au->pck : pck, &size);
+					gf_rmt_begin(gf_bifs_decode_au, GF_RMT_AGGREGATE);
+					e = gf_bifs_decode_au(st->sc->bifs_dec, st->ESID, data, size, ts_offset);
+					gf_rmt_end();
+				}
+				if (ctx->heap) sys_heap_end(&ctx->mem, SYS_HEAP_SCENE);
+				if (do_timing) now = gf_sys_clock_high_res() - now;
 
-		if (!gf_sc_check_sys_frame(scene, odm, pid, filter, cts, 0))
-			continue;
+				GF_LOG(GF_LOG_DEBUG, GF_LOG_CODEC, ("[BIFS] ODM%d #CH%d %s AU TS %u in "LLU" us\n", odm->ID, st->ESID, (au && !au->pck) ? "applied" : "decoded", cts, now));
+				if (ctx->fbudget) sys_budget_spend((au ? au->parse_us : 0) + now);
+				sys_trace_write(&ctx->tracer, SYS_TRACE_DECODED, st->ESID, odm->ck, cts_us, (u32) now);
 
-		ts_offset = (Double) cts;
-		ts_offset /= 1000.0;
-		now = gf_sys_clock_high_res();
-		e = gf_bifs_decode_au(ctx->bifs_dec, ESID, data, size, ts_offset);
-		now = gf_sys_clock_high_res() - now;
+				if (ctx->dedup && !e) {
+					ctx->nb_applied++;
+					if (is_rap) {
+						st->has_last_rap = GF_TRUE;
+						st->last_rap_size = size;
+						st->last_rap_crc = crc;
+						st->last_rap_seq = ctx->nb_applied;
+					}
+				}
+			}
 
-		GF_LOG(GF_LOG_DEBUG, GF_LOG_CODEC, ("[BIFS] ODM%d #CH%d decoded AU TS %u in "LLU" us\n", odm->ID, ESID, cts, now));
+			do_publish = GF_FALSE;
+			if (!is_repeat) {
+				s32 late = sys_stats_au_lateness(odm->ck, cts_us, ctx->stats ? &st->stats : NULL);
+				if (ctx->stats || ctx->heap)
+					do_publish = sys_stats_sample(&st->nb_unpublished, ctx->srate);
+				if (ctx->stats) {
+					if (au) sys_stats_add(&st->stats, au->size, au->parse_us + now);
+					else sys_stats_add(&st->stats, size, now);
+					if (late < 0)
+						st->stats.nb_late++;
+					if (do_publish) {
+						sys_stats_publish(&st->stats, st->opid);
+						sys_stats_publish_clock(odm->ck, st->opid);
+					}
+				}
+			}
+			if (au) {
+				gf_list_rem(st->decoded_aus, 0);
+				if (ctx->heap) sys_heap_begin(&ctx->mem);
+				bifs_dec_del_au(au);
+				if (ctx->heap) sys_heap_end(&ctx->mem, SYS_HEAP_COMS);
+			} else {
+				gf_filter_pid_drop_packet(pid);
+			}
+			if (ctx->heap && do_publish) {
+				sys_heap_count(&ctx->mem, st->sc->graph, scene);
+				sys_heap_publish(&ctx->mem, st->opid);
+			}
 
-		gf_filter_pid_drop_packet(pid);
+			if (e) {
+				if (!ctx->resync) return e;
+				//keep decoding other streams, and this one from its next RAP
+				GF_LOG(GF_LOG_WARNING, GF_LOG_CODEC, ("[BIFS] ODM%d #CH%d error decoding AU TS %u: %s, waiting for next RAP\n", odm->ID, st->ESID, cts, gf_error_to_string(e)));
+				st->nb_errors++;
+				gf_filter_pid_set_info_str(st->opid, "dec_errors", &PROP_UINT(st->nb_errors) );
+				st->wait_rap = GF_TRUE;
+				e = GF_OK;
+				break;
+			}
+			//next AU is part of the same update, apply it before attaching the scene
+			in_group = (ctx->ctsgroup && bifs_dec_next_at(ctx, st, cts_us)) ? GF_TRUE : GF_FALSE;
+			if (in_group) continue;
+			if (odm == st->sc->odm)
+				gf_scene_attach_to_compositor(scene);
 
-		if (e) return e;
-		if (odm == ctx->odm)
-			gf_scene_attach_to_compositor(scene);
+			if (!ctx->budget) break;
+			if (gf_sys_clock_high_res() - start_time >= ctx->budget) {
+				budget_over = GF_TRUE;
+				break;
+			}
+		}
+		if (budget_over) {
+			//start with the next PID at next call so that a busy stream does not starve the others
+			ctx->next_pid_idx = (pid_idx + 1) % count;
+			break;
+		}
+	}
+
+	if (ctx->budget) {
+		u32 budget_left;
+		now = gf_sys_clock_high_res() - start_time;
+		budget_left = (now < ctx->budget) ? (u32) (ctx->budget - now) : 0;
+		GF_LOG(GF_LOG_DEBUG, GF_LOG_CODEC, ("[BIFS] process done, %u us budget left\n", budget_left));
+		//report the budget left to the session on the output PIDs, only when it changes
+		if (budget_left != ctx->budget_left) {
+			ctx->budget_left = budget_left;
+			for (i=0; i<count; i++) {
+				BIFSDecStream *st = gf_filter_pid_get_udta(gf_filter_get_ipid(filter, i));
+				if (st && st->opid)
+					gf_filter_pid_set_info_str(st->opid, "dec_budget_left", &PROP_UINT(budget_left) );
+			}
+		}
+		//budget exhausted with due AUs possibly pending, ask to be called again asap
+		if (budget_over)
+			gf_filter_ask_rt_reschedule(filter, 0);
 	}
+	//wake up when the next pending AU is due rather than being polled until then
+	if (!budget_over && next_due_us)
+		gf_filter_ask_rt_reschedule(filter, next_due_us);
 	return GF_OK;
 }
 
+GF_Err bifs_dec_process(GF_Filter *filter)
+{
+	GF_Err e;
+	gf_rmt_begin(bifs_dec_process, GF_RMT_AGGREGATE);
+	e = bifs_dec_process_aus(filter);
+	gf_rmt_end();
+	return e;
+}
+
 static void bifs_dec_finalize(GF_Filter *filter)
 {
+	u32 i, count;
 	GF_BIFSDecCtx *ctx = gf_filter_get_udta(filter);
-	if (ctx->bifs_dec) gf_bifs_decoder_del(ctx->bifs_dec);
+	//pending commands must be destroyed before the decoder and its graph
+	count = gf_filter_get_ipid_count(filter);
+	for (i=0; i<count; i++) {
+		GF_FilterPid *pid = gf_filter_get_ipid(filter, i);
+		BIFSDecStream *st = gf_filter_pid_get_udta(pid);
+		if (!st) continue;
+		gf_filter_pid_set_udta(pid, NULL);
+		bifs_dec_del_stream(st);
+	}
+	while (gf_list_count(ctx->scenes)) {
+		BIFSDecScene *sc = gf_list_pop_back(ctx->scenes);
+		if (sc->bifs_dec) gf_bifs_decoder_del(sc->bifs_dec);
+		if (sc->own_graph) gf_sg_del(sc->graph);
+		gf_free(sc);
+	}
+	gf_list_del(ctx->scenes);
+	sys_heap_unregister(&ctx->mem);
+	sys_metrics_unregister(&ctx->metrics);
+	sys_trace_close(&ctx->tracer);
 }
 
 
+/*gets the decoder of the scene of the object manager, creating it if needed
+without multins, all PIDs share the decoder of the first attached scene, other namespaces being rejected at configure time*/
+static BIFSDecScene *bifs_dec_get_scene(GF_BIFSDecCtx *ctx, GF_ObjectManager *odm)
+{
+	u32 i, count;
+	BIFSDecScene *sc;
+	GF_Scene *scene = odm->subscene ? odm->subscene : odm->parentscene;
+
+	if (!ctx->scenes) {
+		ctx->scenes = gf_list_new();
+		if (!ctx->scenes) return NULL;
+	}
+	count = gf_list_count(ctx->scenes);
+	if (!ctx->multins && count) return gf_list_get(ctx->scenes, 0);
+	for (i=0; i<count; i++) {
+		sc = gf_list_get(ctx->scenes, i);
+		if (sc->scene == scene) return sc;
+	}
+	GF_SAFEALLOC(sc, BIFSDecScene);
+	if (!sc) return NULL;
+	sc->odm = odm;
+	sc->scene = scene;
+	gf_list_add(ctx->scenes, sc);
+	return sc;
+}
+
 static Bool bifs_dec_process_event(GF_Filter *filter, const GF_FilterEvent *com)
 {
 	u32 count, i;
@@ -226,6 +1197,20 @@ static Bool bifs_dec_process_event(GF_Filter *filter, const GF_FilterEvent *com)
 		break;
 	case GF_FEVT_PLAY:
 		ctx->is_playing = GF_TRUE;
+		if (!com->base.on_pid) return GF_FALSE;
+		//the event is sent on the output PID, whose udta is the object manager: locate the stream through the input PIDs
+		count = gf_filter_get_ipid_count(filter);
+		for (i=0; i<count; i++) {
+			BIFSDecStream *st = gf_filter_pid_get_udta(gf_filter_get_ipid(filter, i));
+			if (!st || (st->opid != com->base.on_pid)) continue;
+			if (com->play.start_range>0) {
+				st->seek_target = (u32) (com->play.start_range * 1000);
+				st->in_seek = GF_TRUE;
+			}
+			//scene may be reset, next RAP must be applied
+			if (ctx->dedup) st->has_last_rap = GF_FALSE;
+			break;
+		}
 		return GF_FALSE;
 	case GF_FEVT_RESET_SCENE:
 		return GF_FALSE;
@@ -238,15 +1223,16 @@ static Bool bifs_dec_process_event(GF_Filter *filter, const GF_FilterEvent *com)
 	count = gf_filter_get_ipid_count(filter);
 	for (i=0; i<count; i++) {
 		GF_FilterPid *ipid = gf_filter_get_ipid(filter, i);
-		GF_FilterPid *opid = gf_filter_pid_get_udta(ipid);
+		BIFSDecStream *st = gf_filter_pid_get_udta(ipid);
 		//we found our pid, set it up
-		if (opid == com->attach_scene.on_pid) {
-			if (!ctx->odm) {
-				ctx->odm = com->attach_scene.object_manager;
-				ctx->scene = ctx->odm->subscene ? ctx->odm->subscene : ctx->odm->parentscene;
+		if (st && (st->opid == com->attach_scene.on_pid)) {
+			if (!st->sc) {
+				st->sc = bifs_dec_get_scene(ctx, com->attach_scene.object_manager);
+				if (!st->sc) return GF_TRUE;
 			}
-			bifs_dec_configure_bifs_dec(ctx, ipid);
-			gf_filter_pid_set_udta(opid, com->attach_scene.object_manager);
+			st->odm = com->attach_scene.object_manager;
+			bifs_dec_configure_bifs_dec(ctx, st);
+			gf_filter_pid_set_udta(st->opid, com->attach_scene.object_manager);
 			return GF_TRUE;
 		}
 	}
@@ -254,6 +1240,37 @@ static Bool bifs_dec_process_event(GF_Filter *filter, const GF_FilterEvent *com)
 	return GF_TRUE;
 }
 
+#define OFFS(_n)	#_n, offsetof(GF_BIFSDecCtx, _n)
+static const GF_FilterArgs BIFSDecArgs[] =
+{
+	{ OFFS(split), "decode AUs into command lists on reception and only apply them at CTS - see filter help", GF_PROP_BOOL, "false", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(lookau), "maximum number of AUs parsed ahead of their CTS in split mode", GF_PROP_UINT, "1", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(lookahead), "time window in milliseconds in which AUs beyond the next one are parsed ahead in split mode (0 means no time limit)", GF_PROP_UINT, "0", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(coalesce), "drop field replaces superseded by a later replace of the same field in the same AU in split mode - see filter help", GF_PROP_BOOL, "false", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(multins), "decode PIDs of all scene namespaces in this instance rather than one instance per namespace - see filter help", GF_PROP_BOOL, "false", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(headless), "decode without compositor into command list summaries sent on the output PIDs - see filter help", GF_PROP_BOOL, "false", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(stats), "collect decode statistics and publish them as info properties of the output PIDs - see filter help", GF_PROP_BOOL, "false", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(dedup), "drop RAP AUs identical to the last applied RAP of the stream - see filter help", GF_PROP_BOOL, "false", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(srate), "update statistics and heap info properties every given number of decoded AUs (0 or 1 means every AU)", GF_PROP_UINT, "1", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(heap), "account heap usage of the decoder and publish it as info properties of the output PIDs - see filter help", GF_PROP_BOOL, "false", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(immediate), "apply AUs on arrival rather than at CTS - see filter help\n"
+	"- no: apply AUs at CTS\n"
+	"- live: apply AUs on arrival for live or low latency streams\n"
+	"- all: apply all AUs on arrival", GF_PROP_UINT, "no", "no|live|all", GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(maxhold), "maximum time in milliseconds an AU is held waiting for its CTS once received (0 means no limit)", GF_PROP_UINT, "0", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(resync), "on decoding error, drop AUs of the stream until the next RAP instead of failing - see filter help", GF_PROP_BOOL, "false", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(ctsgroup), "apply consecutive AUs with the same CTS in the same call - see filter help", GF_PROP_BOOL, "false", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(maxau), "drop AUs larger than the given size in bytes (0 means no limit) - see filter help", GF_PROP_UINT, "0", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(maxcoms), "drop AUs with more than the given number of commands in split mode (0 means no limit) - see filter help", GF_PROP_UINT, "0", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(catchup), "drop due AUs preceding the last due RAP once AUs are late by more than the given time in milliseconds (0 disables) - see filter help", GF_PROP_UINT, "0", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(trim), "release the decoder of a scene once all its streams are in end of stream - see filter help", GF_PROP_BOOL, "false", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(trace), "record a binary trace of AU scheduling and decoding to the given file - see filter help", GF_PROP_STRING, NULL, NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(odsync), "hold AUs while OD AUs of the same timeline with lower or equal CTS are pending in the OD decoder - see filter help", GF_PROP_BOOL, "false", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(fbudget), "time budget in microseconds per compositor frame shared by all BIFS and OD decoders of the session (0 means no limit) - see filter help", GF_PROP_UINT, "0", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(budget), "decode all due AUs of each input until the given time budget in microseconds is spent - see filter help", GF_PROP_UINT, "0", NULL, GF_FS_ARG_HINT_EXPERT},
+	{0}
+};
+
 static const GF_FilterCapability BIFSDecCaps[] =
 {
 	CAP_UINT(GF_CAPS_INPUT,GF_PROP_PID_STREAM_TYPE, GF_STREAM_SCENE),
@@ -268,10 +1285,105 @@ GF_FilterRegister BIFSDecRegister = {
 	.name = "bifsdec",
 	GF_FS_SET_DESCRIPTION("MPEG-4 BIFS decoder")
 	GF_FS_SET_HELP("This filter decodes MPEG-4 BIFS binary frames directly into the scene graph of the compositor.\n"
-	"Note: This filter cannot be used to dump BIFS content to text or xml, use `MP4Box` for that.")
+	"Note: This filter cannot be used to dump BIFS content to text or xml, use `MP4Box` for that.\n"
+	"\n"
+	"By default, at most one AU per input PID is decoded at each call. When [-budget]() is set, all AUs already due are decoded "
+	"until the budget is spent, and the filter asks to be rescheduled immediately if the budget was exhausted. "
+	"The budget left at the end of the last call, in microseconds, is published in the `dec_budget_left` info property of the output PIDs.\n"
+
+	"\n"
+	"The [-fbudget]() option sets a time budget per compositor frame shared by all BIFS and OD decoders of the session. "
+	"Once the time spent decoding system streams since the compositor started its last frame exceeds it, remaining due AUs are left for the next frame. "
+	"BIFS AUs are also held while OD AUs of the same timeline and with lower or equal CTS are held, so that object descriptors are always updated before the scene using them.\n"
+	"\n"
+	"BIFS and OD streams of a scene are decoded by two filters scheduled independently, so a BIFS AU may be applied before the OD AU of the same CTS "
+	"declaring the objects it uses, and these objects are then only resolved at a later frame. "
+	"When [-odsync]() is set, BIFS AUs are held while OD AUs of the same timeline with lower or equal CTS are pending in `odfdec`, which always decodes them first.\n"
+	"\n"
+	"When [-split]() is set, decoding is done in two stages: each AU is parsed into a command list as soon as it is received, "
+	"and only the application of the commands to the scene graph waits for the AU CTS. "
+	"This removes parsing time from the presentation time of the AU, at the cost of keeping decoded AUs in memory.\n"
+	"The number of AUs parsed ahead is given by [-lookau](), and further limited to AUs due within [-lookahead]() milliseconds if set. "
+	"Parsing ahead stops after a RAP or an AU changing the scene structure (any command other than a replace of a non-node field), "
+	"so that later AUs only resolve node, route and proto IDs once these are applied. "
+	"An AU due after such a pending AU of another stream of the same scene is not parsed ahead either.\n"
+	"An AU which cannot be parsed ahead of time, typically because it uses nodes created by AUs not yet applied, is decoded directly at its CTS.\n"
+	"\n"
+	"When [-coalesce]() is set in split mode, a FieldReplace or IndexedValueReplace of an AU superseded by a later replace of the same field (or of the same item) "
+	"in the same AU is dropped before the AU is applied. Only commands on nodes with no routes, script bindings or event listeners are coalesced, "
+	"and any other command between the two replaces prevents coalescing, so that intermediate values observable by the scene are kept. "
+	"The number of dropped commands is published in the `dec_coalesced` info property of the output PID.\n"
+	"\n"
+	"By default, a new filter instance is created for each scene namespace (main scene and each inline scene). "
+	"When [-multins]() is set, a single instance decodes PIDs of all namespaces, with one BIFS decoder per scene, which avoids per-instance scheduling overhead on pages with many inline scenes. "
+	"The [-budget]() option then applies to all scenes of the instance.\n"
+	"\n"
+	"When [-headless]() is set, no compositor is needed: AUs are decoded as soon as they are received, into a scene graph owned by the filter, "
+	"and each AU produces an output packet with the same timing describing the decoded commands. For each command, the packet holds:\n"
+	"- u8: command tag (GF_SG_* values)\n"
+	"- u32: ID of the target node, 0 if none\n"
+	"- u16: number of fields, followed for each field by its index (u16), its type (u8, GF_SG_VRML_* values) and its position (s32, -1 for append)\n"
+	"Field values are not serialised. Timing, seek and split mode options do not apply in this mode.\n"
+	"\n"
+	"When [-immediate]() is set, AUs are applied as soon as they are received, once the object clock runs, instead of waiting for their CTS. "
+	"In `live` mode this only applies to streams with no playback mode (not seekable), or whose PID carries a `lowlat` property set to true. "
+	"Independently, [-maxhold]() bounds the time an AU is held after it is first checked, so that a stream with wrong server timing cannot delay interactions. "
+	"AUs applied before their CTS are counted in `dec_early` in stats mode.\n"
+	"\n"
+	"When [-resync]() is set, an AU failing to decode does not stop the filter: the error is counted in the `dec_errors` info property of the output PID, "
+	"the following AUs of the stream are dropped until a RAP, which replaces the scene, is received, and other streams keep being decoded meanwhile.\n"
+	"\n"
+	"When [-ctsgroup]() is set, consecutive AUs of a stream with the same CTS, as produced by encoders splitting an update over several packets, "
+	"are applied in the same call regardless of [-budget]() and [-fbudget](), and the scene is only attached to the compositor once all of them are applied, "
+	"so that no frame is drawn with a partial update. This is disabled by default, since such a group is not bounded by the budgets.\n"
+	"\n"
+	"The work caused by a single AU can be bounded against corrupted or hostile streams: AUs larger than [-maxau]() are dropped without being decoded, "
+	"and in split mode, AUs parsed into more than [-maxcoms]() commands are dropped before any of their commands is applied. "
+	"Dropped AUs are counted in `dec_dropped` in stats mode. Limits on node count and proto recursion within an AU are up to the BIFS decoder of libgpac.\n"
+	"\n"
+	"When [-catchup]() is set, typically after a stall of the player, and the next AU of a stream is late by more than the given time, "
+	"all AUs already due are pulled from the input and the ones preceding the last due RAP are dropped, as the RAP replaces the scene they update. "
+	"The scene is then back in sync after a single scene replace instead of going through every intermediate state. If no RAP is due, AUs are applied as usual.\n"
+	"\n"
+	"When [-trim]() is set, the decoder of a scene, holding stream configurations, quantization and proto decoding state, is released once all "
+	"BIFS streams of the scene are in end of stream with no pending AU, unless the scene uses conditionals which may still be activated. "
+	"The scene graph is kept, and the decoder is recreated and configured again if new AUs are received, for example after a seek.\n"
+	"\n"
+	"When [-trace]() is set, a binary trace of AU scheduling is written to the given file: each check of a not yet due AU, each due AU, "
+	"each AU dropped as a repeat and each decoded AU, with its ESID, CTS, clock state and decode duration, for offline analysis of frame pacing issues. "
+	"The file starts with the 4CC `SYST`, followed by fixed size big-endian records shared with `odfdec`. Headless mode is not traced.\n"
+	"\n"
+	"When [-stats]() is set, the following info properties are updated on each output PID after each AU:\n"
+	"- dec_aus, dec_bytes: number and total size of decoded AUs\n"
+	"- dec_min_us, dec_avg_us, dec_max_us, dec_p99_us: decode time in microseconds (parsing and application in split mode)\n"
+	"- dec_dropped: number of AUs dropped without being decoded\n"
+	"- dec_late: number of AUs decoded after their CTS\n"
+	"- dec_gated: number of times the next AU was checked and found not yet due\n"
+	"- dec_early: number of AUs decoded before their CTS\n"
+	"- dec_late_p50_us, dec_late_p99_us, dec_late_max_us: median, 99th percentile and max of the decode time minus CTS in microseconds, for AUs decoded at or after their CTS\n"
+	"- ck_buffer_events, ck_buffering_ms: number of buffering stalls of the object clock and total buffering time\n"
+	"- ck_paused_ms: total time the object clock was paused, buffering included\n"
+	"- ck_late_aus, ck_max_late_ms, ck_avg_late_ms: number of late system AUs decoded on the object clock, max and average lateness\n"
+	"These statistics, merged over all inputs, are also exposed to the host through `dynCall_sys_metrics_count`, `dynCall_sys_metrics_name` and `dynCall_sys_metrics_get`, "
+	"the latter filling a fixed-layout metrics structure including the decode time histogram (bucket bounds given by `dynCall_sys_metrics_bucket_max`).\n"
+	"\n"
+	"When [-dedup]() is set, a RAP AU which is a byte-identical copy of the last RAP applied on the same stream, with no other AU applied "
+	"by the decoder in between, is dropped at its CTS without being decoded, as typically found in broadcast carousels. "
+	"The number of dropped repeats is published in the `dec_repeats` info property of the output PID.\n"
+	"\n"
+	"When [-heap]() is set, the heap growth around each decoder operation is accounted and the following info properties are updated on each output PID after each AU:\n"
+	"- heap_scene: net bytes allocated when applying AUs to the scene (nodes, routes and protos)\n"
+	"- heap_coms: net bytes held by command lists and AUs pending in split mode\n"
+	"- heap_peak: maximum of the total net bytes of the decoder\n"
+	"- heap_def_nodes, heap_routes, heap_protos, heap_odms: number of DEF nodes, routes and protos of the graph, and number of objects of the scene\n"
+	"The same accounting is exposed to the host through `dynCall_sys_heap_count` and `dynCall_sys_heap_get`. "
+	"Measuring the heap walks the allocator state and is costly, this mode is meant for budget enforcement and diagnostics.\n"
+	"Unless GPAC memory tracking is enabled, the heap in use is measured for the whole process: with threads on, allocations done meanwhile by other filters "
+	"or threads are accounted too, and the numbers are not per filter.\n")
 	.private_size = sizeof(GF_BIFSDecCtx),
 	.flags = GF_FS_REG_MAIN_THREAD,
 	.priority = 1,
+	.args = BIFSDecArgs,
 	SETCAPS(BIFSDecCaps),
 	.finalize = bifs_dec_finalize,
 	.process = bifs_dec_process,
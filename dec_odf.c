@@ -27,22 +27,128 @@
 #include <gpac/constants.h>
 #include <gpac/compositor.h>
 
+#include "sys_stats.h"
+
 #ifndef GPAC_DISABLE_COMPOSITOR
 
+/*command categories for stats*/
+enum
+{
+	ODF_COM_OD_UPDATE = 0,
+	ODF_COM_OD_REMOVE,
+	ODF_COM_ESD_UPDATE,
+	ODF_COM_ESD_REMOVE,
+	ODF_COM_IPMP,
+	ODF_COM_USER,
+	ODF_COM_LAST
+};
+
+/*info property names per command category: count, bytes, decode and setup time*/
+static const char *ODFComStatsNames[ODF_COM_LAST][4] =
+{
+	{"dec_odu_coms", "dec_odu_bytes", "dec_odu_dec_us", "dec_odu_setup_us"},
+	{"dec_odr_coms", "dec_odr_bytes", "dec_odr_dec_us", "dec_odr_setup_us"},
+	{"dec_esdu_coms", "dec_esdu_bytes", "dec_esdu_dec_us", "dec_esdu_setup_us"},
+	{"dec_esdr_coms", "dec_esdr_bytes", "dec_esdr_dec_us", "dec_esdr_setup_us"},
+	{"dec_ipmp_coms", "dec_ipmp_bytes", "dec_ipmp_dec_us", "dec_ipmp_setup_us"},
+	{"dec_user_coms", "dec_user_bytes", "dec_user_dec_us", "dec_user_setup_us"},
+};
+
+typedef struct
+{
+	u32 nb_coms;
+	u64 nb_bytes;
+	u64 decode_us, setup_us;
+} ODFComStats;
+
+/*per input PID state, created at PID configure*/
+typedef struct
+{
+	GF_FilterPid *ipid, *opid;
+	//object manager attached to the output PID, set at scene attach
+	GF_ObjectManager *odm;
+	u16 ESID;
+	u32 timescale;
+	//timestamp to clock time conversion, setup for the PID or packet timescale
+	GF_TimestampRescaler tsr;
+	//OD codec reused across AUs of this PID
+	GF_ODCodec *codec;
+
+	//dedup mode: size and CRC of the last applied RAP, and value of the apply counter of the decoder after it was applied
+	Bool has_last_rap;
+	u32 last_rap_size, last_rap_crc;
+	u64 last_rap_seq;
+	u32 nb_repeats;
+
+	GF_SysStats stats;
+	ODFComStats com_stats[ODF_COM_LAST];
+	//immediate apply and max hold state
+	GF_SysGate gate;
+	//unframed input: bytes received and not yet decoded, holding a partial command
+	Bool unframed;
+	u8 *buf;
+	u32 buf_size, buf_alloc;
+	//AUs since stats were last published
+	u32 nb_unpublished;
+	//lazy mode: copies of input sensor ODs not yet referenced by the scene
+	GF_List *lazy_ods;
+} ODFDecStream;
+
 typedef struct
 {
+	//options
+	Bool dedup, comsplit, stats, heap, multins, batch, lazy;
+	char *trace;
+	u32 immediate, maxhold, srate, fbudget, warmup;
+
 	GF_ObjectManager *odm;
 	GF_Scene *scene;
 	Bool is_playing;
 	GF_FilterPid *out_pid;
+	//number of AUs applied on all inputs, used to detect carousel repeats in dedup mode
+	u64 nb_applied;
+	//heap accounting, registered at first process in heap mode
+	GF_SysHeap mem;
+	//host metrics queries, registered at first process in stats mode
+	GF_SysDecoder metrics;
+	//scheduling trace, opened at first process
+	GF_SysTrace tracer;
 } GF_ODFDecCtx;
 
+static void odf_dec_del_stream(ODFDecStream *st)
+{
+	if (st->codec) gf_odf_codec_del(st->codec);
+	if (st->buf) gf_free(st->buf);
+	if (st->lazy_ods) {
+		while (gf_list_count(st->lazy_ods)) {
+			GF_Descriptor *od = gf_list_pop_back(st->lazy_ods);
+			gf_odf_desc_del(od);
+		}
+		gf_list_del(st->lazy_ods);
+	}
+	gf_free(st);
+}
+
+static void odf_dec_refresh_stream(GF_ODFDecCtx *ctx, ODFDecStream *st)
+{
+	const GF_PropertyValue *prop;
+	st->ESID = 0;
+	prop = gf_filter_pid_get_property(st->ipid, GF_PROP_PID_ID);
+	if (prop) st->ESID = prop->value.uint;
+	st->timescale = 0;
+	prop = gf_filter_pid_get_property(st->ipid, GF_PROP_PID_TIMESCALE);
+	if (prop) st->timescale = prop->value.uint;
+	sys_gate_setup(&st->gate, st->ipid, ctx->immediate);
+	prop = gf_filter_pid_get_property(st->ipid, GF_PROP_PID_UNFRAMED);
+	st->unframed = (prop && prop->value.boolean) ? GF_TRUE : GF_FALSE;
+}
+
 
 GF_Err odf_dec_configure_pid(GF_Filter *filter, GF_FilterPid *pid, Bool is_remove)
 {
 	GF_ODFDecCtx *ctx = gf_filter_get_udta(filter);
 	Bool in_iod = GF_FALSE;
-	GF_FilterPid *out_pid;
+	ODFDecStream *st;
 	const GF_PropertyValue *prop;
 
 	//we must have streamtype SCENE
@@ -61,65 +167,355 @@ GF_Err odf_dec_configure_pid(GF_Filter *filter, GF_FilterPid *pid, Bool is_remov
 		return GF_NOT_SUPPORTED;
 	}
 
+	st = gf_filter_pid_get_udta(pid);
 	if (is_remove) {
-		out_pid = gf_filter_pid_get_udta(pid);
-		if (out_pid==ctx->out_pid)
-			ctx->out_pid = NULL;
-		if (out_pid)
-			gf_filter_pid_remove(out_pid);
+		if (st) {
+			if (st->opid==ctx->out_pid)
+				ctx->out_pid = NULL;
+			if (st->opid)
+				gf_filter_pid_remove(st->opid);
+			gf_filter_pid_set_udta(pid, NULL);
+			odf_dec_del_stream(st);
+		}
 		return GF_OK;
 	}
 
 	//this is a reconfigure
-	if (gf_filter_pid_get_udta(pid)) {
+	if (st) {
+		odf_dec_refresh_stream(ctx, st);
 		return GF_OK;
 	}
 
-	//check our namespace
-	if (ctx->scene && ! gf_filter_pid_is_filter_in_parents(pid, ctx->scene->root_od->scene_ns->source_filter)) {
+	//check our namespace, unless we handle several of them (commands are applied to the scene of each PID)
+	if (!ctx->multins && ctx->scene && ! gf_filter_pid_is_filter_in_parents(pid, ctx->scene->root_od->scene_ns->source_filter)) {
 		return GF_REQUIRES_NEW_INSTANCE;
 	}
 
+	GF_SAFEALLOC(st, ODFDecStream);
+	if (!st) return GF_OUT_OF_MEM;
+	st->ipid = pid;
+	st->codec = gf_odf_codec_new();
+	if (!st->codec) {
+		gf_free(st);
+		return GF_OUT_OF_MEM;
+	}
+	odf_dec_refresh_stream(ctx, st);
+
 	//declare a new output PID of type scene, codecid RAW
-	out_pid = gf_filter_pid_new(filter);
+	st->opid = gf_filter_pid_new(filter);
 
 	//copy properties at init or reconfig
-	gf_filter_pid_copy_properties(out_pid, pid);
-	gf_filter_pid_set_property(out_pid, GF_PROP_PID_CODECID, &PROP_UINT(GF_CODECID_RAW) );
-	gf_filter_pid_set_udta(pid, out_pid);
+	gf_filter_pid_copy_properties(st->opid, pid);
+	gf_filter_pid_set_property(st->opid, GF_PROP_PID_CODECID, &PROP_UINT(GF_CODECID_RAW) );
+	gf_filter_pid_set_udta(pid, st);
 	if (!ctx->out_pid)
-		ctx->out_pid = out_pid;
+		ctx->out_pid = st->opid;
 	return GF_OK;
 }
 
-static void attach_desc_to_odm(GF_ObjectManager *odm, GF_ObjectDescriptor *od)
+/*if take_od is set, the OD is not used by the caller after this call and may be moved to the object manager rather
+than copied; take_od is then set to TRUE and the URL of the OD (if any) is left to the caller*/
+static void attach_desc_to_odm(GF_ObjectManager *odm, GF_ObjectDescriptor *od, Bool *take_od)
 {
+	if (odm->OD == od) return;
 	if (odm->OD) {
 		gf_odf_desc_del((GF_Descriptor *)odm->OD);
 		odm->OD = NULL;
 	}
 	if (gf_list_count(od->OCIDescriptors)) {
-		char *url = od->URLString;
+		char *url;
+		if (take_od) {
+			od->URLString = NULL;
+			odm->OD = od;
+			*take_od = GF_TRUE;
+			return;
+		}
+		url = od->URLString;
 		od->URLString = NULL;
 		gf_odf_desc_copy((GF_Descriptor *) od, (GF_Descriptor **) &odm->OD);
 		od->URLString = url;
 	}
 
 }
+/*index of scene resources for one OD update, mapping ESIDs (main and extra PIDs) and OD IDs of objects without PID
+to the first matching resource. Entries are sorted by key then position in scene->resources*/
+typedef struct
+{
+	u32 key;
+	u32 pos;
+	GF_ObjectManager *odm;
+} ODResEntry;
+
+typedef struct
+{
+	ODResEntry *es;
+	u32 nb_es;
+	ODResEntry *ods;
+	u32 nb_ods;
+	Bool valid;
+} ODResIndex;
+
+static int odf_dec_cmp_res(const void *a, const void *b)
+{
+	const ODResEntry *e1 = a, *e2 = b;
+	if (e1->key != e2->key) return (e1->key < e2->key) ? -1 : 1;
+	if (e1->pos != e2->pos) return (e1->pos < e2->pos) ? -1 : 1;
+	return 0;
+}
+
+static void odf_dec_res_index_reset(ODResIndex *idx)
+{
+	if (idx->es) gf_free(idx->es);
+	if (idx->ods) gf_free(idx->ods);
+	memset(idx, 0, sizeof(ODResIndex));
+}
+
+static void odf_dec_res_index_build(ODResIndex *idx, GF_Scene *scene)
+{
+	u32 i, count, nb_es=0, nb_ods=0;
+	memset(idx, 0, sizeof(ODResIndex));
+	count = gf_list_count(scene->resources);
+	for (i=0; i<count; i++) {
+		GF_ObjectManager *odm = gf_list_get(scene->resources, i);
+		if (!odm->pid) {
+			if (odm->mo) nb_ods++;
+		} else {
+			nb_es += 1 + gf_list_count(odm->extra_pids);
+		}
+	}
+	if (nb_es) idx->es = gf_malloc(sizeof(ODResEntry) * nb_es);
+	if (nb_ods) idx->ods = gf_malloc(sizeof(ODResEntry) * nb_ods);
+	if ((nb_es && !idx->es) || (nb_ods && !idx->ods)) {
+		odf_dec_res_index_reset(idx);
+		return;
+	}
+	for (i=0; i<count; i++) {
+		GF_ObjectManager *odm = gf_list_get(scene->resources, i);
+		if (!odm->pid) {
+			if (!odm->mo) continue;
+			idx->ods[idx->nb_ods].key = odm->mo->OD_ID;
+			idx->ods[idx->nb_ods].pos = i;
+			idx->ods[idx->nb_ods].odm = odm;
+			idx->nb_ods++;
+		} else {
+			u32 k=0;
+			GF_ODMExtraPid *xpid;
+			idx->es[idx->nb_es].key = odm->pid_id;
+			idx->es[idx->nb_es].pos = i;
+			idx->es[idx->nb_es].odm = odm;
+			idx->nb_es++;
+			while ( (xpid = gf_list_enum(odm->extra_pids, &k))) {
+				idx->es[idx->nb_es].key = xpid->pid_id;
+				idx->es[idx->nb_es].pos = i;
+				idx->es[idx->nb_es].odm = odm;
+				idx->nb_es++;
+			}
+		}
+	}
+	if (idx->nb_es) qsort(idx->es, idx->nb_es, sizeof(ODResEntry), odf_dec_cmp_res);
+	if (idx->nb_ods) qsort(idx->ods, idx->nb_ods, sizeof(ODResEntry), odf_dec_cmp_res);
+	idx->valid = GF_TRUE;
+}
+
+//get first entry (lowest position) for key
+static ODResEntry *odf_dec_res_index_find(ODResEntry *tab, u32 nb_entries, u32 key)
+{
+	u32 lo=0, hi=nb_entries;
+	while (lo<hi) {
+		u32 mid = (lo+hi)/2;
+		if (tab[mid].key < key) lo = mid+1;
+		else hi = mid;
+	}
+	if ((lo<nb_entries) && (tab[lo].key==key)) return &tab[lo];
+	return NULL;
+}
+
+/*locate the resource for an ESD: the first object in scene->resources either carrying the ESID on one of its PIDs,
+or without PID and with a media object of the same OD ID (interaction and scene streams), in which case is_od_match is set*/
+static GF_ObjectManager *odf_dec_find_esd_odm(GF_Scene *scene, ODResIndex *idx, u32 ESID, u32 OD_ID, GF_FilterPid **out_pid, Bool *is_od_match)
+{
+	u32 i, count;
+	GF_ObjectManager *odm;
+
+	*out_pid = NULL;
+	*is_od_match = GF_FALSE;
+	count = gf_list_count(scene->resources);
+
+	if (idx && idx->valid) {
+		ODResEntry *es = odf_dec_res_index_find(idx->es, idx->nb_es, ESID);
+		ODResEntry *od = odf_dec_res_index_find(idx->ods, idx->nb_ods, OD_ID);
+		ODResEntry *best = es;
+		if (od && (!best || (od->pos < best->pos))) best = od;
+
+		//make sure the resource list was not modified before this entry
+		if (best && (count > best->pos) && (gf_list_get(scene->resources, best->pos) == best->odm)
+			&& ((best==od) ? !best->odm->pid : (best->odm->pid!=NULL))
+		) {
+			if (best==od) *is_od_match = GF_TRUE;
+			else *out_pid = best->odm->pid;
+			return best->odm;
+		} else if (best) {
+			GF_LOG(GF_LOG_DEBUG, GF_LOG_CODEC, ("[ODF] Scene resources modified during OD update, disabling index\n"));
+			idx->valid = GF_FALSE;
+		}
+		//no match in indexed objects: objects added since, or whose PID or media object was attached after the build,
+		//are only found by the full scan below
+	}
+
+	for (i=0; i<count; i++) {
+		u32 k=0;
+		GF_ODMExtraPid *xpid;
+		odm = gf_list_get(scene->resources, i);
+		//can happen with interaction and scene streams
+		if (!odm->pid) {
+			if (odm->mo && odm->mo->OD_ID == OD_ID) {
+				*is_od_match = GF_TRUE;
+				return odm;
+			}
+			continue;
+		}
+
+		if (odm->pid_id == ESID) {
+			*out_pid = odm->pid;
+			return odm;
+		}
+		while ( (xpid = gf_list_enum(odm->extra_pids, &k))) {
+			if (xpid->pid_id == ESID) {
+				*out_pid = odm->pid;
+				return odm;
+			}
+		}
+	}
+	return NULL;
+}
+
+/*object setup staged during an OD update in batch mode, for a PID or a remote URL*/
+typedef struct
+{
+	GF_ObjectManager *odm;
+	GF_FilterPid *pid;
+	char *url;
+	//URL no longer owned by the OD, freed once setup
+	Bool free_url;
+} ODSetupEntry;
+
+typedef struct
+{
+	ODSetupEntry *entries;
+	u32 nb_entries, nb_alloc;
+} ODSetupBatch;
+
+static void odf_dec_setup_od(GF_Scene *scene, GF_ObjectDescriptor *od, ODResIndex *idx, Bool *od_moved, ODSetupBatch *batch, GF_List *lazy_ods);
+
 void ODS_SetupOD(GF_Scene *scene, GF_ObjectDescriptor *od)
+{
+	gf_rmt_begin(ODS_SetupOD, GF_RMT_AGGREGATE);
+	odf_dec_setup_od(scene, od, NULL, NULL, NULL, NULL);
+	gf_rmt_end();
+}
+
+//returns TRUE if a media object of the scene refers to the given OD ID
+static Bool odf_dec_od_used(GF_Scene *scene, u32 OD_ID)
+{
+	u32 i=0;
+	GF_MediaObject *mo;
+	while ((mo = gf_list_enum(scene->scene_objects, &i))) {
+		if (mo->OD_ID == OD_ID) return GF_TRUE;
+	}
+	return GF_FALSE;
+}
+
+static GF_ObjectDescriptor *odf_dec_lazy_find(GF_List *lazy_ods, u32 OD_ID, u32 *pos)
+{
+	u32 i, count = gf_list_count(lazy_ods);
+	for (i=0; i<count; i++) {
+		GF_ObjectDescriptor *od = gf_list_get(lazy_ods, i);
+		if (od->objectDescriptorID != OD_ID) continue;
+		if (pos) *pos = i;
+		return od;
+	}
+	return NULL;
+}
+
+static void odf_dec_lazy_remove(GF_List *lazy_ods, u32 OD_ID)
+{
+	u32 pos;
+	GF_ObjectDescriptor *od = odf_dec_lazy_find(lazy_ods, OD_ID, &pos);
+	if (!od) return;
+	gf_list_rem(lazy_ods, pos);
+	gf_odf_desc_del((GF_Descriptor *) od);
+}
+
+/*sets up the pending ODs now referenced by the scene, returns TRUE if some are still pending*/
+static Bool odf_dec_lazy_check(GF_Scene *scene, GF_List *lazy_ods)
+{
+	u32 i=0;
+	while (i<gf_list_count(lazy_ods)) {
+		Bool moved = GF_FALSE;
+		GF_ObjectDescriptor *od = gf_list_get(lazy_ods, i);
+		if (!odf_dec_od_used(scene, od->objectDescriptorID)) {
+			i++;
+			continue;
+		}
+		gf_list_rem(lazy_ods, i);
+		GF_LOG(GF_LOG_DEBUG, GF_LOG_CODEC, ("[ODF] OD %d now used by the scene, setting up input sensor\n", od->objectDescriptorID));
+		odf_dec_setup_od(scene, od, NULL, &moved, NULL, NULL);
+		if (!moved) gf_odf_desc_del((GF_Descriptor *) od);
+	}
+	return gf_list_count(lazy_ods) ? GF_TRUE : GF_FALSE;
+}
+
+static ODSetupEntry *odf_dec_batch_add(ODSetupBatch *batch, GF_ObjectManager *odm)
+{
+	ODSetupEntry *ent;
+	if (batch->nb_entries == batch->nb_alloc) {
+		batch->nb_alloc = batch->nb_alloc ? 2*batch->nb_alloc : 16;
+		batch->entries = gf_realloc(batch->entries, sizeof(ODSetupEntry) * batch->nb_alloc);
+	}
+	ent = &batch->entries[batch->nb_entries++];
+	memset(ent, 0, sizeof(ODSetupEntry));
+	ent->odm = odm;
+	return ent;
+}
+
+/*connects all objects staged by an OD update, under a single compositor lock so that the scene is only updated once*/
+static void odf_dec_batch_flush(GF_Scene *scene, ODSetupBatch *batch)
+{
+	u32 i;
+	if (!batch->nb_entries) return;
+	if (scene->compositor) gf_sc_lock(scene->compositor, GF_TRUE);
+	for (i=0; i<batch->nb_entries; i++) {
+		ODSetupEntry *ent = &batch->entries[i];
+		if (ent->url) {
+			gf_odm_setup_remote_object(ent->odm, scene->root_od->scene_ns, ent->url, GF_FALSE);
+			if (ent->free_url) gf_free(ent->url);
+		} else {
+			gf_odm_setup_object(ent->odm, scene->root_od->scene_ns, ent->pid);
+		}
+	}
+	if (scene->compositor) gf_sc_lock(scene->compositor, GF_FALSE);
+	batch->nb_entries = 0;
+}
+
+/*if od_moved is set, the OD may be handed over to the object manager for its last use, in which case od_moved is set to TRUE
+and the caller no longer owns the OD. If batch is set, PID and remote object setups are staged in the batch rather than done.
+If lazy_ods is set, a copy of input sensor ODs not referenced by the scene is kept there rather than setting them up*/
+static void odf_dec_setup_od(GF_Scene *scene, GF_ObjectDescriptor *od, ODResIndex *idx, Bool *od_moved, ODSetupBatch *batch, GF_List *lazy_ods)
 {
 	u32 i, j, count, nb_scene, nb_od, nb_esd;
 	GF_ESD *esd;
 	GF_ObjectManager *odm;
 
 	if (od->URLString) {
+		char *url = od->URLString;
+		Bool moved = GF_FALSE;
 		odm = gf_odm_new();
 		odm->ID = od->objectDescriptorID;
 		odm->parentscene = scene;
 		if (od->fake_remote)
 			odm->ignore_sys = GF_TRUE;
 
-		attach_desc_to_odm(odm, od);
+		attach_desc_to_odm(odm, od, od_moved ? &moved : NULL);
 
 		gf_list_add(scene->resources, odm);
 		if (odm->ID != GF_MEDIA_EXTERNAL_ID) {
@@ -137,7 +533,18 @@ void ODS_SetupOD(GF_Scene *scene, GF_ObjectDescriptor *od)
 				}
 			}
 		}
-		gf_odm_setup_remote_object(odm, scene->root_od->scene_ns, od->URLString, GF_FALSE);
+		if (batch) {
+			ODSetupEntry *ent = odf_dec_batch_add(batch, odm);
+			ent->url = url;
+			ent->free_url = moved;
+			if (moved) *od_moved = GF_TRUE;
+			return;
+		}
+		gf_odm_setup_remote_object(odm, scene->root_od->scene_ns, url, GF_FALSE);
+		if (moved) {
+			gf_free(url);
+			*od_moved = GF_TRUE;
+		}
 		return;
 	}
 
@@ -153,46 +560,30 @@ void ODS_SetupOD(GF_Scene *scene, GF_ObjectDescriptor *od)
 	for (j=0; j<nb_esd; j++) {
 		Bool skip_od = GF_FALSE;
 		GF_FilterPid *pid = NULL;
+		//the OD is no longer used once attached for the last ESD
+		Bool *take_od = (od_moved && (j+1==nb_esd)) ? od_moved : NULL;
 		esd = gf_list_get(od->ESDescriptors, j);
 
-		count = gf_list_count(scene->resources);
-		for (i=0; i<count; i++) {
-			u32 k=0;
-			GF_ODMExtraPid *xpid;
-			odm = gf_list_get(scene->resources, i);
-			//can happen with interaction and scene streams
-			if (!odm->pid) {
-				if (odm->mo && odm->mo->OD_ID == od->objectDescriptorID) {
-					odm->ServiceID = od->ServiceID;
-					attach_desc_to_odm(odm, od);
-					skip_od = GF_TRUE;
-					break;
-				}
-				odm = NULL;
-				continue;
-			}
-
-			if (odm->pid_id == esd->ESID) {
-				pid = odm->pid;
-				break;
-			}
-			while ( (xpid = gf_list_enum(odm->extra_pids, &k))) {
-				if (xpid->pid_id == esd->ESID) {
-					pid = odm->pid;
-					break;
-				}
-			}
-			if (pid) break;
-			odm = NULL;
-		}
-		if (skip_od)
+		odm = odf_dec_find_esd_odm(scene, idx, esd->ESID, od->objectDescriptorID, &pid, &skip_od);
+		if (skip_od) {
+			odm->ServiceID = od->ServiceID;
+			attach_desc_to_odm(odm, od, take_od);
 			continue;
+		}
 
 		//OCR streams and input sensors don't have PIDs associated for now (only local sensors supported)
 		if ((esd->decoderConfig->streamType == GF_STREAM_INTERACT)
 			|| (esd->decoderConfig->streamType == GF_STREAM_OCR)
 		) {
 #ifndef GPAC_DISABLE_VRML
+			//no node uses this input sensor yet, keep it until one does
+			if (!odm && lazy_ods && (esd->decoderConfig->streamType == GF_STREAM_INTERACT) && !odf_dec_od_used(scene, od->objectDescriptorID)) {
+				GF_ObjectDescriptor *copy = NULL;
+				odf_dec_lazy_remove(lazy_ods, od->objectDescriptorID);
+				if (gf_odf_desc_copy((GF_Descriptor *) od, (GF_Descriptor **) &copy) == GF_OK)
+					gf_list_add(lazy_ods, copy);
+				return;
+			}
 			//first time we setup this stream, create an ODM
 			if (!odm) {
 				odm = gf_odm_new();
@@ -205,7 +596,7 @@ void ODS_SetupOD(GF_Scene *scene, GF_ObjectDescriptor *od)
 				odm->scene_ns->nb_odm_users++;
 				gf_list_add(scene->resources, odm);
 			}
-			attach_desc_to_odm(odm, od);
+			attach_desc_to_odm(odm, od, take_od);
 
 			if (esd->decoderConfig->streamType == GF_STREAM_INTERACT) {
 				gf_scene_setup_object(scene, odm);
@@ -240,107 +631,460 @@ void ODS_SetupOD(GF_Scene *scene, GF_ObjectDescriptor *od)
 
 		}
 		odm->ServiceID = od->ServiceID;
-		attach_desc_to_odm(odm, od);
+		attach_desc_to_odm(odm, od, take_od);
 
 		/*setup PID for this object */
-		gf_odm_setup_object(odm, scene->root_od->scene_ns, pid);
+		if (batch) {
+			ODSetupEntry *ent = odf_dec_batch_add(batch, odm);
+			ent->pid = pid;
+		} else {
+			gf_odm_setup_object(odm, scene->root_od->scene_ns, pid);
+		}
 
 	}
 }
 
-static GF_Err ODS_ODUpdate(GF_Scene *scene, GF_ODUpdate *odU)
+/*starts objects declared by an OD update and not yet used by the scene, so that they are buffered once referenced
+objects started without being used count against max_warm*/
+static void odf_dec_warmup(GF_Scene *scene, u16 *ids, u32 nb_ids, u32 max_warm)
 {
-	u32 i, count;
+	u32 i, j, nb_warm = 0, count = gf_list_count(scene->resources);
+	GF_ObjectManager *odm;
+	GF_Clock *scene_ck = scene->root_od ? scene->root_od->ck : NULL;
+
+	for (i=0; i<count; i++) {
+		odm = gf_list_get(scene->resources, i);
+		if (odm->pid && !odm->mo && (odm->state == GF_ODM_STATE_PLAY)) nb_warm++;
+	}
+	for (i=0; (i<count) && (nb_warm<max_warm); i++) {
+		odm = gf_list_get(scene->resources, i);
+		//inline scenes are only started once attached
+		if (!odm->pid || odm->mo || odm->subscene || (odm->state == GF_ODM_STATE_PLAY)) continue;
+		//only objects with a connected PID running on their own clock: no consumer pulls the PID until the scene uses it,
+		//and buffering on the scene clock would stall the scene meanwhile
+		if (!odm->ck || (odm->ck == scene_ck)) continue;
+		for (j=0; j<nb_ids; j++) {
+			if (ids[j] == odm->ID) break;
+		}
+		if (j==nb_ids) continue;
+		GF_LOG(GF_LOG_DEBUG, GF_LOG_CODEC, ("[ODF] Warming up OD %d before use by the scene\n", odm->ID));
+		gf_odm_start(odm);
+		nb_warm++;
+	}
+}
+
+static GF_Err ODS_ODUpdate(GF_Scene *scene, GF_ODUpdate *odU, Bool do_batch, GF_List *lazy_ods, u32 warmup)
+{
+	u32 i, count, nb_esd=0;
+	ODResIndex idx;
+	ODSetupBatch batch;
+	u16 ids[255];
 
 	/*extract all our ODs and compare with what we already have...*/
 	count = gf_list_count(odU->objectDescriptors);
 	if (count > 255) return GF_ODF_INVALID_DESCRIPTOR;
 
+	//only index resources if more than one ESD lookup is needed
 	for (i=0; i<count; i++) {
 		GF_ObjectDescriptor *od = (GF_ObjectDescriptor *)gf_list_get(odU->objectDescriptors, i);
-		ODS_SetupOD(scene, od);
+		if (!od->URLString) nb_esd += gf_list_count(od->ESDescriptors);
+		//IDs are kept for warm-up, ODs may be moved to their object
+		ids[i] = od->objectDescriptorID;
 	}
+	memset(&idx, 0, sizeof(ODResIndex));
+	if (nb_esd>1)
+		odf_dec_res_index_build(&idx, scene);
+
+	memset(&batch, 0, sizeof(ODSetupBatch));
+	//nothing to gain for a single OD
+	if (count<2) do_batch = GF_FALSE;
+
+	i=0;
+	while (i<gf_list_count(odU->objectDescriptors)) {
+		Bool moved = GF_FALSE;
+		GF_ObjectDescriptor *od = (GF_ObjectDescriptor *)gf_list_get(odU->objectDescriptors, i);
+		odf_dec_setup_od(scene, od, nb_esd>1 ? &idx : NULL, &moved, do_batch ? &batch : NULL, lazy_ods);
+		//OD now owned by an object manager, remove it from the command
+		if (moved) gf_list_rem(odU->objectDescriptors, i);
+		else i++;
+	}
+	odf_dec_res_index_reset(&idx);
+	//all ODs resolved, connect their objects
+	odf_dec_batch_flush(scene, &batch);
+	if (batch.entries) gf_free(batch.entries);
+	if (warmup) odf_dec_warmup(scene, ids, count, warmup);
 	return GF_OK;
 }
 
 
 
-static GF_Err ODS_RemoveOD(GF_Scene *scene, GF_ODRemove *odR)
+typedef struct
 {
-	u32 i;
-	for (i=0; i< odR->NbODs; i++) {
-		GF_ObjectManager *odm = gf_scene_find_odm(scene, odR->OD_ID[i]);
-		if (odm) gf_odm_disconnect(odm, 1);
+	u32 OD_ID;
+	u32 nb_req;
+} ODRemoveEntry;
+
+static int odf_dec_cmp_remove(const void *a, const void *b)
+{
+	return (int) ((const ODRemoveEntry *)a)->OD_ID - (int) ((const ODRemoveEntry *)b)->OD_ID;
+}
+
+static GF_Err ODS_RemoveOD(GF_Scene *scene, GF_ODRemove *odR, GF_List *lazy_ods)
+{
+	u32 i, j, nb_ids, count, nb_odms;
+	ODRemoveEntry *ids;
+	GF_ObjectManager *odm, **odms;
+
+	//pending input sensors have no object yet
+	if (lazy_ods && gf_list_count(lazy_ods)) {
+		for (i=0; i<odR->NbODs; i++)
+			odf_dec_lazy_remove(lazy_ods, odR->OD_ID[i]);
+	}
+
+	if (odR->NbODs<=1) {
+		for (i=0; i< odR->NbODs; i++) {
+			odm = gf_scene_find_odm(scene, odR->OD_ID[i]);
+			if (odm) gf_odm_disconnect(odm, 1);
+		}
+		return GF_OK;
+	}
+
+	/*build a sorted table of requested IDs so that a single pass on the scene resources resolves the whole batch.
+	An ID listed N times removes the first N objects with that ID, as successive lookups would do*/
+	ids = gf_malloc(sizeof(ODRemoveEntry) * odR->NbODs);
+	odms = gf_malloc(sizeof(GF_ObjectManager *) * odR->NbODs);
+	if (!ids || !odms) {
+		if (ids) gf_free(ids);
+		if (odms) gf_free(odms);
+		return GF_OUT_OF_MEM;
+	}
+	for (i=0; i<odR->NbODs; i++) {
+		ids[i].OD_ID = odR->OD_ID[i];
+		ids[i].nb_req = 1;
+	}
+	qsort(ids, odR->NbODs, sizeof(ODRemoveEntry), odf_dec_cmp_remove);
+	nb_ids = 0;
+	for (i=0; i<odR->NbODs; i++) {
+		if (nb_ids && (ids[nb_ids-1].OD_ID == ids[i].OD_ID)) {
+			ids[nb_ids-1].nb_req++;
+		} else {
+			ids[nb_ids++] = ids[i];
+		}
+	}
+
+	//collect first, disconnecting modifies the resource list
+	nb_odms = 0;
+	count = gf_list_count(scene->resources);
+	for (i=0; (i<count) && (nb_odms<odR->NbODs); i++) {
+		ODRemoveEntry key, *found;
+		odm = gf_list_get(scene->resources, i);
+		key.OD_ID = odm->ID;
+		found = bsearch(&key, ids, nb_ids, sizeof(ODRemoveEntry), odf_dec_cmp_remove);
+		if (!found || !found->nb_req) continue;
+		found->nb_req--;
+		odms[nb_odms++] = odm;
 	}
+	for (j=0; j<nb_odms; j++) {
+		gf_odm_disconnect(odms[j], 1);
+	}
+	gf_free(ids);
+	gf_free(odms);
 	return GF_OK;
 }
 
-static GF_Err ODS_UpdateESD(GF_Scene *scene, GF_ESDUpdate *ESDs)
+static GF_Err ODS_UpdateESD(GF_Scene *scene, GF_ESDUpdate *ESDs, GF_List *lazy_ods)
 {
-	//no more support for ESD update in new arch (never used anyway)
-	//following is kept for the case we need to reintroduce it one day
-#if 0
+	GF_Err e;
 	GF_ObjectManager *odm;
-	u32 count, i;
-
-	odm = gf_scene_find_odm(priv->scene, ESDs->ODID);
-	/*spec: "ignore"*/
-	if (!odm) return GF_OK;
+	GF_ObjectDescriptor *od = NULL;
+	u32 i;
 
-	count = gf_list_count(ESDs->ESDescriptors);
+	odm = gf_scene_find_odm(scene, ESDs->ODID);
+	if (!odm) {
+		//pending input sensor, add the new streams to its OD
+		od = lazy_ods ? odf_dec_lazy_find(lazy_ods, ESDs->ODID, NULL) : NULL;
+		while (od && gf_list_count(ESDs->ESDescriptors)) {
+			GF_ESD *esd = gf_list_pop_front(ESDs->ESDescriptors);
+			gf_list_add(od->ESDescriptors, esd);
+		}
+		/*spec: "ignore"*/
+		return GF_OK;
+	}
 
-	while (count) {
-		GF_ESD *esd, *prev;
-		esd = (GF_ESD*)gf_list_get(ESDs->ESDescriptors, 0);
-		/*spec: "ES_Descriptors with ES_IDs that have already been received within the same name scope shall be ignored."*/
-		prev = NULL;
-		i=0;
-		while ((prev = (GF_ESD*)gf_list_enum(odm->OD->ESDescriptors, &i))) {
-			if (prev->ESID == esd->ESID) break;
+	/*setup the new streams through an OD carrying only the new ESDs and the OCI of the object, so that
+	the object managers of streams already running are not touched*/
+	if (odm->OD) {
+		e = gf_odf_desc_copy((GF_Descriptor *) odm->OD, (GF_Descriptor **) &od);
+		if (e) return e;
+		while (gf_list_count(od->ESDescriptors)) {
+			GF_ESD *esd = gf_list_pop_back(od->ESDescriptors);
+			gf_odf_desc_del((GF_Descriptor *) esd);
 		}
-		if (prev) {
-			gf_odf_desc_del((GF_Descriptor *)esd);
-		} else {
-			/*and register new stream*/
-			gf_list_add(odm->OD->ESDescriptors, esd);
-			gf_odm_setup_es(odm, esd, odm->net_service, NULL);
+	} else {
+		od = (GF_ObjectDescriptor *) gf_odf_desc_new(GF_ODF_OD_TAG);
+		if (!od) return GF_OUT_OF_MEM;
+	}
+	od->objectDescriptorID = ESDs->ODID;
+	od->ServiceID = odm->ServiceID;
+
+	i=0;
+	while (i<gf_list_count(ESDs->ESDescriptors)) {
+		Bool is_od_match;
+		GF_FilterPid *pid;
+		GF_ObjectManager *es_odm;
+		GF_ESD *esd = gf_list_get(ESDs->ESDescriptors, i);
+		if (!esd->decoderConfig) {
+			i++;
+			continue;
 		}
-
-		/*remove the desc from the AU*/
-		gf_list_rem(ESDs->ESDescriptors, 0);
-		count--;
+		/*spec: "ES_Descriptors with ES_IDs that have already been received within the same name scope shall be ignored."*/
+		es_odm = odf_dec_find_esd_odm(scene, NULL, esd->ESID, ESDs->ODID, &pid, &is_od_match);
+		if (es_odm && !is_od_match) {
+			if (es_odm->ID != ESDs->ODID) {
+				GF_LOG(GF_LOG_WARNING, GF_LOG_CODEC, ("[ODF] ESD update for OD %d: ES ID %d already used by OD %d, ignoring\n", ESDs->ODID, esd->ESID, es_odm->ID));
+			}
+			i++;
+			continue;
+		}
+		/*move the desc from the AU*/
+		gf_list_rem(ESDs->ESDescriptors, i);
+		gf_list_add(od->ESDescriptors, esd);
 	}
-	/*resetup object since a new ES has been inserted
-	(typically an empty object first sent, then a stream added - cf how ogg demuxer works)*/
-	gf_scene_setup_object(priv->scene, odm);
+
+	if (gf_list_count(od->ESDescriptors))
+		odf_dec_setup_od(scene, od, NULL, NULL, NULL, NULL);
+
+	gf_odf_desc_del((GF_Descriptor *) od);
 	return GF_OK;
-#else
-	return GF_NOT_SUPPORTED;
-#endif
 }
 
 
 static GF_Err ODS_RemoveESD(GF_Scene *scene, GF_ESDRemove *ESDs)
 {
+	GF_Err e = GF_OK;
+	u32 i, j, count;
 	GF_ObjectManager *odm = gf_scene_find_odm(scene, ESDs->ODID);
 	/*spec: "ignore"*/
 	if (!odm) return GF_OK;
 
-	return GF_NOT_SUPPORTED;
-	//todo one day (never used before in MPEG-4 systems): find the stream with the given ESID
-	//in the parent filter, and remove it
+	for (i=0; i<ESDs->NbESDs; i++) {
+		Bool found = GF_FALSE;
+		count = gf_list_count(scene->resources);
+		for (j=0; j<count; j++) {
+			u32 k=0;
+			GF_ODMExtraPid *xpid;
+			odm = gf_list_get(scene->resources, j);
+			if (odm->ID != ESDs->ODID) continue;
+
+			/*each stream of the OD has its own object manager, remove it: this disconnects the PID
+			and destroys its decoder and composition buffers right away*/
+			if (odm->pid && (odm->pid_id == ESDs->ES_ID[i])) {
+				found = GF_TRUE;
+				if (odm == scene->root_od) break;
+				gf_odm_disconnect(odm, 1);
+				break;
+			}
+			while ( (xpid = gf_list_enum(odm->extra_pids, &k))) {
+				if (xpid->pid_id == ESDs->ES_ID[i]) break;
+			}
+			if (xpid) {
+				//extra PIDs (scalable or multiplexed streams) cannot be removed without removing their object
+				GF_LOG(GF_LOG_WARNING, GF_LOG_CODEC, ("[ODF] Removing ES %d from OD %d not supported, stream is part of object with ES %d\n", ESDs->ES_ID[i], ESDs->ODID, odm->pid_id));
+				found = GF_TRUE;
+				e = GF_NOT_SUPPORTED;
+				break;
+			}
+		}
+		if (!found) {
+			GF_LOG(GF_LOG_DEBUG, GF_LOG_CODEC, ("[ODF] ES %d not found in OD %d, ignoring removal\n", ESDs->ES_ID[i], ESDs->ODID));
+		}
+	}
+	return e;
 }
 
-GF_Err odf_dec_process(GF_Filter *filter)
+static GF_Err odf_dec_apply_com(GF_ODFDecCtx *ctx, ODFDecStream *st, GF_Scene *scene, GF_ODCom *com)
+{
+	GF_Err e;
+	if (ctx->lazy && !st->lazy_ods) st->lazy_ods = gf_list_new();
+	switch (com->tag) {
+	case GF_ODF_OD_UPDATE_TAG:
+		e = ODS_ODUpdate(scene, (GF_ODUpdate *) com, ctx->batch, st->lazy_ods, ctx->warmup);
+		break;
+	case GF_ODF_OD_REMOVE_TAG:
+		e = ODS_RemoveOD(scene, (GF_ODRemove *) com, st->lazy_ods);
+		break;
+	case GF_ODF_ESD_UPDATE_TAG:
+		e = ODS_UpdateESD(scene, (GF_ESDUpdate *)com, st->lazy_ods);
+		break;
+	case GF_ODF_ESD_REMOVE_TAG:
+		e = ODS_RemoveESD(scene, (GF_ESDRemove *)com);
+		break;
+	case GF_ODF_IPMP_UPDATE_TAG:
+#if 0
+	{
+		GF_IPMPUpdate *ipmpU = (GF_IPMPUpdate *)com;
+		while (gf_list_count(ipmpU->IPMPDescList)) {
+			GF_IPMP_Descriptor *ipmp = gf_list_get(ipmpU->IPMPDescList, 0);
+			gf_list_rem(ipmpU->IPMPDescList, 0);
+			IS_UpdateIPMP(priv->scene, ipmp);
+		}
+		e = GF_OK;
+	}
+#else
+		e = GF_OK;
+#endif
+		break;
+	case GF_ODF_IPMP_REMOVE_TAG:
+		e = GF_NOT_SUPPORTED;
+		break;
+	/*should NEVER exist outside the file format*/
+	case GF_ODF_ESD_REMOVE_REF_TAG:
+		e = GF_NON_COMPLIANT_BITSTREAM;
+		break;
+	default:
+		if (com->tag >= GF_ODF_COM_ISO_BEGIN_TAG && com->tag <= GF_ODF_COM_ISO_END_TAG) {
+			e = GF_ODF_FORBIDDEN_DESCRIPTOR;
+		} else {
+			/*we don't process user commands*/
+			e = GF_OK;
+		}
+		break;
+	}
+	return e;
+}
+
+static void odf_dec_add_com_stats(ODFDecStream *st, u8 tag, u32 size, u64 decode_us, u64 setup_us)
+{
+	ODFComStats *cs;
+	switch (tag) {
+	case GF_ODF_OD_UPDATE_TAG: cs = &st->com_stats[ODF_COM_OD_UPDATE]; break;
+	case GF_ODF_OD_REMOVE_TAG: cs = &st->com_stats[ODF_COM_OD_REMOVE]; break;
+	case GF_ODF_ESD_UPDATE_TAG: cs = &st->com_stats[ODF_COM_ESD_UPDATE]; break;
+	case GF_ODF_ESD_REMOVE_TAG:
+	case GF_ODF_ESD_REMOVE_REF_TAG:
+		cs = &st->com_stats[ODF_COM_ESD_REMOVE];
+		break;
+	case GF_ODF_IPMP_UPDATE_TAG:
+	case GF_ODF_IPMP_REMOVE_TAG:
+		cs = &st->com_stats[ODF_COM_IPMP];
+		break;
+	default: cs = &st->com_stats[ODF_COM_USER]; break;
+	}
+	cs->nb_coms++;
+	cs->nb_bytes += size;
+	cs->decode_us += decode_us;
+	cs->setup_us += setup_us;
+}
+
+static void odf_dec_publish_stats(ODFDecStream *st)
+{
+	u32 i;
+	sys_stats_publish(&st->stats, st->opid);
+	for (i=0; i<ODF_COM_LAST; i++) {
+		ODFComStats *cs = &st->com_stats[i];
+		if (!cs->nb_coms) continue;
+		gf_filter_pid_set_info_str(st->opid, ODFComStatsNames[i][0], &PROP_UINT(cs->nb_coms) );
+		gf_filter_pid_set_info_str(st->opid, ODFComStatsNames[i][1], &PROP_LONGUINT(cs->nb_bytes) );
+		gf_filter_pid_set_info_str(st->opid, ODFComStatsNames[i][2], &PROP_LONGUINT(cs->decode_us) );
+		gf_filter_pid_set_info_str(st->opid, ODFComStatsNames[i][3], &PROP_LONGUINT(cs->setup_us) );
+	}
+}
+
+/*gets the size of the OD command at the start of the buffer, header included, or 0 if the command is truncated*/
+static u32 odf_dec_get_com_size(const u8 *data, u32 size)
+{
+	u32 i, com_size=0;
+	//command tag followed by size coded on up to 4 bytes
+	for (i=1; i<5; i++) {
+		if (i>=size) return 0;
+		com_size = (com_size<<7) | (data[i] & 0x7F);
+		if (!(data[i] & 0x80)) break;
+	}
+	if (i==5) return 0;
+	com_size += i+1;
+	if (com_size > size) return 0;
+	return com_size;
+}
+
+/*max size of pending unframed data without a complete command, beyond which the data is considered corrupted*/
+#define ODF_MAX_PENDING	0x100000
+/*interval in us at which pending input sensor ODs are checked against the scene in lazy mode*/
+#define ODF_LAZY_CHECK_US	50000
+
+/*gets the size of the complete commands at the start of the buffer*/
+static u32 odf_dec_get_complete_size(const u8 *data, u32 size)
+{
+	u32 pos = 0;
+	while (pos < size) {
+		u32 com_size = odf_dec_get_com_size(data + pos, size - pos);
+		if (!com_size) break;
+		pos += com_size;
+	}
+	return pos;
+}
+
+/*gets the commands to decode for an unframed packet: the packet itself if it only holds complete commands and nothing is pending,
+otherwise the complete commands of the pending data to which the packet is appended. size is set to 0 if no command is complete yet*/
+static const u8 *odf_dec_reassemble(ODFDecStream *st, const u8 *data, u32 *size)
+{
+	if (!st->buf_size && (odf_dec_get_complete_size(data, *size) == *size))
+		return data;
+
+	if (st->buf_size + *size > st->buf_alloc) {
+		u8 *buf = gf_realloc(st->buf, st->buf_size + *size);
+		if (!buf) {
+			*size = 0;
+			return NULL;
+		}
+		st->buf = buf;
+		st->buf_alloc = st->buf_size + *size;
+	}
+	memcpy(st->buf + st->buf_size, data, *size);
+	st->buf_size += *size;
+	*size = odf_dec_get_complete_size(st->buf, st->buf_size);
+	if (!*size && (st->buf_size > ODF_MAX_PENDING)) {
+		GF_LOG(GF_LOG_WARNING, GF_LOG_CODEC, ("[ODF] #CH%d no complete command in %u pending bytes, discarding\n", st->ESID, st->buf_size));
+		st->buf_size = 0;
+	}
+	return st->buf;
+}
+
+/*removes decoded commands from the pending unframed data*/
+static void odf_dec_consume(ODFDecStream *st, u32 size)
+{
+	if (size < st->buf_size)
+		memmove(st->buf, st->buf + size, st->buf_size - size);
+	st->buf_size -= size;
+}
+
+/*metrics query callback: merges stats of all input streams, the clock is the one of the first attached stream*/
+static void odf_dec_get_stats(void *owner, GF_SysStats *stats, GF_Clock **ck)
+{
+	u32 i, count;
+	GF_Filter *filter = (GF_Filter *) owner;
+	count = gf_filter_get_ipid_count(filter);
+	for (i=0; i<count; i++) {
+		GF_FilterPid *pid = gf_filter_get_ipid(filter, i);
+		ODFDecStream *st = gf_filter_pid_get_udta(pid);
+		if (!st) continue;
+		sys_stats_merge(stats, &st->stats);
+		if (!*ck && st->odm) *ck = st->odm->ck;
+	}
+}
+
+static GF_Err odf_dec_process_aus(GF_Filter *filter)
 {
 	GF_Err e;
 	GF_ODCom *com;
 	GF_ODCodec *oddec;
-	u64 cts, now;
-	u32 count, i;
-	const char *data;
-	u32 size, ESID=0;
-	const GF_PropertyValue *prop;
+	u64 cts, cts_us, now;
+	u32 count, i, crc, pos, com_pos, timescale;
+	u32 next_due_us = 0;
+	s32 late;
+	u64 dec_us = 0;
+	Bool is_rap, is_due, do_publish;
+	const u8 *data;
+	u32 size;
 	GF_ODFDecCtx *ctx = gf_filter_get_udta(filter);
 
 	if (!ctx->scene) {
@@ -350,20 +1094,44 @@ GF_Err odf_dec_process(GF_Filter *filter)
 		}
 		return GF_OK;
 	}
+	if (ctx->heap && !ctx->mem.owner) sys_heap_register(&ctx->mem, "odfdec", filter);
+	if (ctx->stats && !ctx->metrics.owner) {
+		ctx->metrics.name = "odfdec";
+		ctx->metrics.owner = filter;
+		ctx->metrics.get_stats = odf_dec_get_stats;
+		ctx->metrics.heap = ctx->heap ? &ctx->mem : NULL;
+		sys_metrics_register(&ctx->metrics);
+	}
+	if (ctx->trace && !ctx->tracer.opened) sys_trace_open(&ctx->tracer, ctx->trace, "odfdec");
+
+	//OD AUs left pending at the previous call are checked again below
+	sys_od_barrier_clear(filter);
 
 	count = gf_filter_get_ipid_count(filter);
 	for (i=0; i<count; i++) {
 		GF_Scene *scene;
 		GF_FilterPid *pid = gf_filter_get_ipid(filter, i);
-		GF_FilterPid *opid = gf_filter_pid_get_udta(pid);
-		GF_ObjectManager *odm = gf_filter_pid_get_udta(opid);
+		ODFDecStream *st = gf_filter_pid_get_udta(pid);
+		GF_ObjectManager *odm = st ? st->odm : NULL;
 		if (!odm) continue;
 
+		//pending input sensors may have been referenced by scene updates since the last call
+		if (st->lazy_ods && odf_dec_lazy_check(odm->subscene, st->lazy_ods)) {
+			if (!next_due_us || (ODF_LAZY_CHECK_US < next_due_us))
+				next_due_us = ODF_LAZY_CHECK_US;
+		}
+
 		GF_FilterPacket *pck = gf_filter_pid_get_packet(pid);
 		if (!pck) {
 			Bool is_eos = gf_filter_pid_is_eos(pid);
-			if (is_eos)
-				gf_filter_pid_set_eos(opid);
+			if (is_eos) {
+				//publish last values, updates may have been skipped by sampling
+				if (ctx->stats && st->nb_unpublished) {
+					odf_dec_publish_stats(st);
+					st->nb_unpublished = 0;
+				}
+				gf_filter_pid_set_eos(st->opid);
+			}
 			continue;
 		}
 		data = gf_filter_pck_get_data(pck, &size);
@@ -373,87 +1141,193 @@ GF_Err odf_dec_process(GF_Filter *filter)
 		}
 		scene = odm->subscene;
 
-		prop = gf_filter_pid_get_property(pid, GF_PROP_PID_ID);
-		if (prop) ESID = prop->value.uint;
-
-		cts = gf_filter_pck_get_cts( pck );
-		cts = gf_timestamp_to_clocktime(cts, gf_filter_pck_get_timescale(pck));
-
-		if (!gf_sc_check_sys_frame(scene, odm, pid, filter, cts, 0))
+		timescale = st->timescale ? st->timescale : gf_filter_pck_get_timescale(pck);
+		if (st->tsr.timescale != timescale) gf_timestamp_rescaler_init(&st->tsr, timescale);
+		cts_us = gf_timestamp_rescaler_to_us(&st->tsr, gf_filter_pck_get_cts( pck ));
+		cts = (cts_us / 1000) % 0xFFFFFFFFUL;
+
+		gf_rmt_begin(gf_sc_check_sys_frame, GF_RMT_AGGREGATE);
+		is_due = gf_sc_check_sys_frame(scene, odm, pid, filter, cts, 0);
+		gf_rmt_end();
+		if (!is_due) {
+			//not yet due, remember when the earliest pending AU will be
+			u32 us, hold_us;
+			st->stats.nb_gated++;
+			sys_trace_write(&ctx->tracer, SYS_TRACE_GATED, st->ESID, odm->ck, cts_us, 0);
+			if (!sys_gate_force(&st->gate, odm->ck, cts_us, ctx->maxhold, &hold_us)) {
+				us = gf_clock_us_until(odm->ck, cts);
+				if (hold_us && (!us || (hold_us < us)))
+					us = hold_us;
+				if (us && (!next_due_us || (us < next_due_us)))
+					next_due_us = us;
+				sys_od_barrier_set(filter, odm->ck, cts_us);
+				continue;
+			}
+		}
+		sys_gate_reset(&st->gate);
+
+		//shared frame budget exhausted, keep the AU for the next frame and hold BIFS AUs of the same timeline
+		if (ctx->fbudget && !sys_budget_left(scene->compositor, ctx->fbudget)) {
+			u32 us = sys_budget_wait_us(scene->compositor);
+			if (!us) us = 1000;
+			sys_od_barrier_set(filter, odm->ck, cts_us);
+			if (!next_due_us || (us < next_due_us))
+				next_due_us = us;
 			continue;
+		}
 
-		now = gf_sys_clock_high_res();
-		oddec = gf_odf_codec_new();
-
-		e = gf_odf_codec_set_au(oddec, data, size);
-		if (!e) e = gf_odf_codec_decode(oddec);
+		sys_trace_write(&ctx->tracer, SYS_TRACE_DUE, st->ESID, odm->ck, cts_us, 0);
 
-		gf_filter_pid_drop_packet(pid);
+		//unframed input, decode the complete commands received so far
+		if (st->unframed) {
+			data = odf_dec_reassemble(st, data, &size);
+			if (!size) {
+				gf_filter_pid_drop_packet(pid);
+				continue;
+			}
+		}
 
-		//3- process all the commands in this AU, in order
-		while (e == GF_OK) {
-			com = gf_odf_codec_get_com(oddec);
-			if (!com) break;
+		//carousel repeat of the last applied RAP with nothing applied since, applying it again would not change the scene
+		//not checked for unframed input, packets do not match AUs
+		is_rap = GF_FALSE;
+		crc = 0;
+		if (ctx->dedup && !st->unframed && (gf_filter_pck_get_sap(pck) != GF_FILTER_SAP_NONE)) {
+			is_rap = GF_TRUE;
+			crc = gf_crc_32(data, size);
+			if (st->has_last_rap && (st->last_rap_size == size) && (st->last_rap_crc == crc) && (st->last_rap_seq == ctx->nb_applied)) {
+				GF_LOG(GF_LOG_DEBUG, GF_LOG_CODEC, ("[ODF] ODM%d #CH%d dropping AU TS %u, repeat of last applied RAP\n", odm->ID, st->ESID, cts));
+				sys_trace_write(&ctx->tracer, SYS_TRACE_DROPPED, st->ESID, odm->ck, cts_us, 0);
+				st->nb_repeats++;
+				gf_filter_pid_set_info_str(st->opid, "dec_repeats", &PROP_UINT(st->nb_repeats) );
+				gf_filter_pid_drop_packet(pid);
+				continue;
+			}
+		}
 
-			//ok, we have a command
-			switch (com->tag) {
-			case GF_ODF_OD_UPDATE_TAG:
-				e = ODS_ODUpdate(scene, (GF_ODUpdate *) com);
-				break;
-			case GF_ODF_OD_REMOVE_TAG:
-				e = ODS_RemoveOD(scene, (GF_ODRemove *) com);
-				break;
-			case GF_ODF_ESD_UPDATE_TAG:
-				e = ODS_UpdateESD(scene, (GF_ESDUpdate *)com);
-				break;
-			case GF_ODF_ESD_REMOVE_TAG:
-				e = ODS_RemoveESD(scene, (GF_ESDRemove *)com);
-				break;
-			case GF_ODF_IPMP_UPDATE_TAG:
-#if 0
-			{
-				GF_IPMPUpdate *ipmpU = (GF_IPMPUpdate *)com;
-				while (gf_list_count(ipmpU->IPMPDescList)) {
-					GF_IPMP_Descriptor *ipmp = gf_list_get(ipmpU->IPMPDescList, 0);
-					gf_list_rem(ipmpU->IPMPDescList, 0);
-					IS_UpdateIPMP(priv->scene, ipmp);
+		now = gf_sys_clock_high_res();
+		oddec = st->codec;
+		if (ctx->heap) sys_heap_begin(&ctx->mem);
+
+		//3- decode and process all the commands in this AU, in order
+		e = GF_OK;
+		pos = 0;
+		while (!e && (pos < size)) {
+			u32 dec_size = size - pos;
+			//in comsplit mode, decode a single command at a time
+			if (ctx->comsplit) {
+				dec_size = odf_dec_get_com_size(data + pos, size - pos);
+				if (!dec_size) {
+					e = GF_NON_COMPLIANT_BITSTREAM;
+					break;
 				}
-				e = GF_OK;
 			}
-#else
-				e = GF_OK;
-#endif
-				break;
-			case GF_ODF_IPMP_REMOVE_TAG:
-				e = GF_NOT_SUPPORTED;
-				break;
-			/*should NEVER exist outside the file format*/
-			case GF_ODF_ESD_REMOVE_REF_TAG:
-				e = GF_NON_COMPLIANT_BITSTREAM;
-				break;
-			default:
-				if (com->tag >= GF_ODF_COM_ISO_BEGIN_TAG && com->tag <= GF_ODF_COM_ISO_END_TAG) {
-					e = GF_ODF_FORBIDDEN_DESCRIPTOR;
-				} else {
-					/*we don't process user commands*/
-					e = GF_OK;
+			com_pos = pos;
+			if (ctx->stats) dec_us = gf_sys_clock_high_res();
+			e = gf_odf_codec_set_au(oddec, data + pos, dec_size);
+			if (!e) e = gf_odf_codec_decode(oddec);
+			if (ctx->stats) dec_us = gf_sys_clock_high_res() - dec_us;
+			pos += dec_size;
+
+			while (e == GF_OK) {
+				u32 com_size = 0;
+				u64 setup_us = 0;
+				com = gf_odf_codec_get_com(oddec);
+				if (!com) break;
+
+				if (ctx->stats) {
+					//commands are listed in AU order, locate this one for its size
+					com_size = odf_dec_get_com_size(data + com_pos, pos - com_pos);
+					com_pos += com_size;
+					setup_us = gf_sys_clock_high_res();
 				}
-				break;
+				e = odf_dec_apply_com(ctx, st, scene, com);
+				if (ctx->stats) {
+					setup_us = gf_sys_clock_high_res() - setup_us;
+					//decode time is per command in comsplit mode, otherwise shared between commands of the AU by size
+					odf_dec_add_com_stats(st, com->tag, com_size, dec_size ? (dec_us * com_size / dec_size) : 0, setup_us);
+				}
+				gf_odf_com_del(&com);
 			}
+		}
+		if (data == st->buf) odf_dec_consume(st, size);
+		gf_filter_pid_drop_packet(pid);
+
+		//reset the codec for next AU: flush commands left after an error, and recreate it if it is stuck with a previous AU
+		while ((com = gf_odf_codec_get_com(oddec))) {
 			gf_odf_com_del(&com);
 		}
+		if (e == GF_BAD_PARAM) {
+			gf_odf_codec_del(st->codec);
+			st->codec = gf_odf_codec_new();
+		}
+		do_publish = (ctx->stats || ctx->heap) ? sys_stats_sample(&st->nb_unpublished, ctx->srate) : GF_FALSE;
+		if (ctx->heap) {
+			sys_heap_end(&ctx->mem, SYS_HEAP_DESC);
+			if (do_publish) {
+				sys_heap_count(&ctx->mem, NULL, scene);
+				sys_heap_publish(&ctx->mem, st->opid);
+			}
+		}
 
-		gf_odf_codec_del(oddec);
+		if (ctx->dedup) {
+			ctx->nb_applied++;
+			st->has_last_rap = (is_rap && !e) ? GF_TRUE : GF_FALSE;
+			st->last_rap_size = size;
+			st->last_rap_crc = crc;
+			st->last_rap_seq = ctx->nb_applied;
+		}
 
 		now = gf_sys_clock_high_res() - now;
-		GF_LOG(GF_LOG_DEBUG, GF_LOG_CODEC, ("[ODF] ODM%d #CH%d decoded AU TS %u in "LLU" us\n", odm->ID, ESID, cts, now));
+		GF_LOG(GF_LOG_DEBUG, GF_LOG_CODEC, ("[ODF] ODM%d #CH%d decoded AU TS %u in "LLU" us\n", odm->ID, st->ESID, cts, now));
+		sys_trace_write(&ctx->tracer, SYS_TRACE_DECODED, st->ESID, odm->ck, cts_us, (u32) now);
+		if (ctx->fbudget) sys_budget_spend(now);
+
+		late = sys_stats_au_lateness(odm->ck, cts_us, ctx->stats ? &st->stats : NULL);
+		if (ctx->stats) {
+			sys_stats_add(&st->stats, size, now);
+			if (late < 0)
+				st->stats.nb_late++;
+			if (do_publish) {
+				odf_dec_publish_stats(st);
+				sys_stats_publish_clock(odm->ck, st->opid);
+			}
+		}
 	}
 
+	//wake up when the next pending AU is due rather than being polled until then
+	if (next_due_us)
+		gf_filter_ask_rt_reschedule(filter, next_due_us);
 	return GF_OK;
 }
 
+GF_Err odf_dec_process(GF_Filter *filter)
+{
+	GF_Err e;
+	gf_rmt_begin(odf_dec_process, GF_RMT_AGGREGATE);
+	e = odf_dec_process_aus(filter);
+	gf_rmt_end();
+	return e;
+}
 
 
+
+static void odf_dec_finalize(GF_Filter *filter)
+{
+	GF_ODFDecCtx *ctx = gf_filter_get_udta(filter);
+	u32 i, count = gf_filter_get_ipid_count(filter);
+	for (i=0; i<count; i++) {
+		GF_FilterPid *pid = gf_filter_get_ipid(filter, i);
+		ODFDecStream *st = gf_filter_pid_get_udta(pid);
+		if (!st) continue;
+		gf_filter_pid_set_udta(pid, NULL);
+		odf_dec_del_stream(st);
+	}
+	sys_heap_unregister(&ctx->mem);
+	sys_metrics_unregister(&ctx->metrics);
+	sys_od_barrier_clear(filter);
+	sys_trace_close(&ctx->tracer);
+}
+
 static Bool odf_dec_process_event(GF_Filter *filter, const GF_FilterEvent *com)
 {
 	u32 count, i;
@@ -464,6 +1338,17 @@ static Bool odf_dec_process_event(GF_Filter *filter, const GF_FilterEvent *com)
 		break;
 	case GF_FEVT_PLAY:
 		ctx->is_playing = GF_TRUE;
+		if (!ctx->dedup || !com->base.on_pid) return GF_FALSE;
+		//scene may be reset, next RAP must be applied
+		//the event is sent on the output PID, whose udta is the object manager: locate the stream through the input PIDs
+		count = gf_filter_get_ipid_count(filter);
+		for (i=0; i<count; i++) {
+			ODFDecStream *st = gf_filter_pid_get_udta(gf_filter_get_ipid(filter, i));
+			if (st && (st->opid == com->base.on_pid)) {
+				st->has_last_rap = GF_FALSE;
+				break;
+			}
+		}
 		return GF_FALSE;
 	default:
 		return GF_FALSE;
@@ -474,14 +1359,15 @@ static Bool odf_dec_process_event(GF_Filter *filter, const GF_FilterEvent *com)
 	//attach inline scenes
 	for (i=0; i<count; i++) {
 		GF_FilterPid *ipid = gf_filter_get_ipid(filter, i);
-		GF_FilterPid *opid = gf_filter_pid_get_udta(ipid);
+		ODFDecStream *st = gf_filter_pid_get_udta(ipid);
 		//we found our pid, set it up
-		if (opid == com->attach_scene.on_pid) {
+		if (st && (st->opid == com->attach_scene.on_pid)) {
 			if (!ctx->odm) {
 				ctx->odm = com->attach_scene.object_manager;
 				ctx->scene = ctx->odm->subscene ? ctx->odm->subscene : ctx->odm->parentscene;
 			}
-			gf_filter_pid_set_udta(opid, com->attach_scene.object_manager);
+			st->odm = com->attach_scene.object_manager;
+			gf_filter_pid_set_udta(st->opid, com->attach_scene.object_manager);
 			return GF_TRUE;
 		}
 	}
@@ -489,10 +1375,31 @@ static Bool odf_dec_process_event(GF_Filter *filter, const GF_FilterEvent *com)
 	return GF_TRUE;
 }
 
+#define OFFS(_n)	#_n, offsetof(GF_ODFDecCtx, _n)
+static const GF_FilterArgs ODFDecArgs[] =
+{
+	{ OFFS(immediate), "apply AUs on arrival rather than at CTS, as in `bifsdec`\n"
+	"- no: apply AUs at CTS\n"
+	"- live: apply AUs on arrival for live or low latency streams\n"
+	"- all: apply all AUs on arrival", GF_PROP_UINT, "no", "no|live|all", GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(maxhold), "maximum time in milliseconds an AU is held waiting for its CTS once received (0 means no limit)", GF_PROP_UINT, "0", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(fbudget), "time budget in microseconds per compositor frame shared by all BIFS and OD decoders of the session (0 means no limit) - see filter help", GF_PROP_UINT, "0", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(dedup), "drop RAP AUs identical to the last applied RAP of the stream - see filter help", GF_PROP_BOOL, "false", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(comsplit), "decode and apply commands of an AU one at a time - see filter help", GF_PROP_BOOL, "false", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(batch), "resolve all ODs of an OD update before setting up their objects - see filter help", GF_PROP_BOOL, "false", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(trace), "record a binary trace of AU scheduling and decoding to the given file, as in `bifsdec`", GF_PROP_STRING, NULL, NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(warmup), "maximum number of objects started before being used by the scene - see filter help", GF_PROP_UINT, "0", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(lazy), "only setup input sensor objects once used by the scene - see filter help", GF_PROP_BOOL, "false", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(multins), "decode PIDs of all scene namespaces in this instance rather than one instance per namespace", GF_PROP_BOOL, "false", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(stats), "collect decode statistics and publish them as info properties of the output PIDs - see filter help", GF_PROP_BOOL, "false", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(srate), "update statistics and heap info properties every given number of decoded AUs (0 or 1 means every AU)", GF_PROP_UINT, "1", NULL, GF_FS_ARG_HINT_EXPERT},
+	{ OFFS(heap), "account heap usage of the decoder and publish it as info properties of the output PIDs - see filter help", GF_PROP_BOOL, "false", NULL, GF_FS_ARG_HINT_EXPERT},
+	{0}
+};
+
 static const GF_FilterCapability ODFDecCaps[] =
 {
 	CAP_UINT(GF_CAPS_INPUT,GF_PROP_PID_STREAM_TYPE, GF_STREAM_OD),
-	CAP_BOOL(GF_CAPS_INPUT_EXCLUDED, GF_PROP_PID_UNFRAMED, GF_TRUE),
 	CAP_UINT(GF_CAPS_INPUT,GF_PROP_PID_CODECID, GF_CODECID_OD_V1),
 	CAP_UINT(GF_CAPS_INPUT,GF_PROP_PID_CODECID, GF_CODECID_OD_V2),
 	CAP_UINT(GF_CAPS_OUTPUT, GF_PROP_PID_STREAM_TYPE, GF_STREAM_OD),
@@ -503,11 +1410,52 @@ GF_FilterRegister ODFDecRegister = {
 	.name = "odfdec",
 	GF_FS_SET_DESCRIPTION("MPEG-4 OD decoder")
 	GF_FS_SET_HELP("This filter decodes MPEG-4 OD binary frames directly into the scene manager of the compositor.\n"
-	"Note: This filter cannot be used to dump OD content to text or xml, use `MP4Box` for that.")
+	"Note: This filter cannot be used to dump OD content to text or xml, use `MP4Box` for that.\n"
+	"\n"
+	"When [-dedup]() is set, a RAP AU which is a byte-identical copy of the last RAP applied on the same stream, with no other AU applied "
+	"by the decoder in between, is dropped without being decoded, as typically found in broadcast carousels. "
+	"The number of dropped repeats is published in the `dec_repeats` info property of the output PID.\n"
+	"\n"
+	"Unframed input is accepted: packets may then hold any part of the command stream. Complete commands are decoded at the CTS of the packet completing them, "
+	"directly from the packet data when it only holds complete commands, and the trailing partial command is kept for the next packet. "
+	"Carousel repeats are not detected for unframed input.\n"
+	"\n"
+	"The [-fbudget]() option sets a time budget per compositor frame shared with `bifsdec`. Once exhausted, due AUs are kept for the next frame, "
+	"and BIFS AUs of the same timeline with equal or higher CTS are held until they are decoded.\n"
+	"\n"
+	"Each AU left pending, not yet due or deferred by the budget, is signaled to `bifsdec` which can then hold BIFS AUs of the same timeline "
+	"with equal or higher CTS until it is decoded, see the `odsync` option of `bifsdec`.\n"
+	"\n"
+	"When [-batch]() is set, all ODs of an OD update are first resolved against the scene resources, and the objects of the update "
+	"are then connected in a single pass with the compositor locked, so that updates declaring many objects, such as mosaics, are set up in one scene update.\n"
+	"\n"
+	"When [-warmup]() is set, media objects declared by an OD update and not yet used by the scene are started right away, "
+	"so that their PIDs are connected and buffered when a later scene update inserts nodes using them. "
+	"At most [-warmup]() such objects are started at any time, each buffering up to the PID buffer limits of the session, which bounds the memory used. "
+	"Inline scenes are not started ahead, nor are objects whose PID is not connected yet or which run on the clock of the scene, "
+	"since buffering such an object, with no consumer until the scene uses it, would stall the scene.\n"
+	"\n"
+	"When [-lazy]() is set, the object of an input sensor OD is only created once a media object of the scene refers to its OD ID, "
+	"typically once an `InputSensor` node using it is inserted. Until then the OD is kept by the decoder, checked at each call, "
+	"and removed by OD remove commands. OCR streams are always setup as they drive the object clocks.\n"
+	"\n"
+	"When [-comsplit]() is set, each command of an AU is decoded and applied before the next one is decoded, rather than decoding the whole AU first. "
+	"This bounds memory usage for large AUs and starts setting up objects earlier, but commands preceding a corrupted one in the AU are applied.\n"
+	"\n"
+	"When [-stats]() is set, the AU statistics properties of `bifsdec` are published on each output PID after each AU and exposed to the host metrics queries, "
+	"along with the following properties per command type (`odu`, `odr`, `esdu`, `esdr`, `ipmp` and `user`, e.g. `dec_odu_coms`):\n"
+	"- dec_TYPE_coms, dec_TYPE_bytes: number and total size of commands\n"
+	"- dec_TYPE_dec_us: decoding time in microseconds, estimated from the command size unless [-comsplit]() is set\n"
+	"- dec_TYPE_setup_us: time in microseconds spent applying the commands to the scene\n"
+	"\n"
+	"When [-heap]() is set, the heap accounting properties of `bifsdec` are published on each output PID after each AU, "
+	"with `heap_desc` giving the net bytes allocated by OD commands (descriptors and object managers) and `heap_odms` the number of objects of the scene.\n")
 	.private_size = sizeof(GF_ODFDecCtx),
 	.flags = GF_FS_REG_MAIN_THREAD,
 	.priority = 1,
+	.args = ODFDecArgs,
 	SETCAPS(ODFDecCaps),
+	.finalize = odf_dec_finalize,
 	.process = odf_dec_process,
 	.configure_pid = odf_dec_configure_pid,
 	.process_event = odf_dec_process_event,
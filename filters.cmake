@@ -26,4 +26,44 @@ macro(add_filter FILTERNAME ENTRYFILES LINKFILES ENTRY_FN DEFINITIONS INCLUDES L
         target_include_directories(${FILTERNAME}_${VERSION} PRIVATE ${INCLUDES})
         file(READ ${CMAKE_CURRENT_SOURCE_DIR}/${FILTERNAME}.json FILTER_JSON_DESC)
         list(APPEND FILTERS_JSON_DESC "\"${FILTERNAME}_${VERSION}.wasm\":${FILTER_JSON_DESC}")
-endmacro()
\ No newline at end of file
+endmacro()
+
+# builds a variant of a filter with extra compile and link flags (e.g. SIMD or threads), named FILTERNAME_VERSION_VARIANT.wasm
+# the variant is advertised in FILTERS_JSON_DESC with a "variant" field added to the filter description
+macro(add_filter_variant FILTERNAME VARIANT ENTRYFILES LINKFILES ENTRY_FN DEFINITIONS INCLUDES COMPILE_FLAGS LINK_FLAGS VERSION)
+        list(APPEND WASM_FILES ${CMAKE_BINARY_DIR}/${FILTERNAME}_${VARIANT}.wasm)
+
+        add_executable(${FILTERNAME}_${VERSION}_${VARIANT} ${ENTRYFILES})
+
+        target_link_libraries(${FILTERNAME}_${VERSION}_${VARIANT} ${LINKFILES})
+
+        set_target_properties(${FILTERNAME}_${VERSION}_${VARIANT}
+                PROPERTIES
+                LINK_FLAGS " -sWASM_BIGINT -s SIDE_MODULE=2 -s EXPORTED_FUNCTIONS=${ENTRY_FN} ${COMPILE_FLAGS} ${LINK_FLAGS}"
+        )
+
+        separate_arguments(VARIANT_COMPILE_FLAGS UNIX_COMMAND "${COMPILE_FLAGS}")
+        target_compile_options(${FILTERNAME}_${VERSION}_${VARIANT} PRIVATE ${VARIANT_COMPILE_FLAGS})
+        target_compile_definitions(${FILTERNAME}_${VERSION}_${VARIANT} PRIVATE ${DEFINITIONS})
+        target_include_directories(${FILTERNAME}_${VERSION}_${VARIANT} PRIVATE ${INCLUDES})
+        file(READ ${CMAKE_CURRENT_SOURCE_DIR}/${FILTERNAME}.json FILTER_JSON_DESC)
+        string(REGEX REPLACE "^[ \t\r\n]*{" "{\"variant\":\"${VARIANT}\"," FILTER_JSON_DESC "${FILTER_JSON_DESC}")
+        list(APPEND FILTERS_JSON_DESC "\"${FILTERNAME}_${VERSION}_${VARIANT}.wasm\":${FILTER_JSON_DESC}")
+endmacro()
+
+# builds a side module shared by several filters (e.g. common clock code), named LIBNAME_VERSION.wasm
+# all its symbols are exported; filters list ${LIBNAME}_LIB in their LINKFILES to load it as a dependency, and it is not advertised in FILTERS_JSON_DESC
+macro(add_filter_lib LIBNAME ENTRYFILES DEFINITIONS INCLUDES LINK_FLAGS VERSION)
+        list(APPEND WASM_FILES ${CMAKE_BINARY_DIR}/${LIBNAME}_${VERSION}.wasm)
+
+        add_executable(${LIBNAME}_${VERSION} ${ENTRYFILES})
+
+        set_target_properties(${LIBNAME}_${VERSION}
+                PROPERTIES
+                LINK_FLAGS " -sWASM_BIGINT -s SIDE_MODULE=1 ${LINK_FLAGS}"
+        )
+
+        target_compile_definitions(${LIBNAME}_${VERSION} PRIVATE ${DEFINITIONS})
+        target_include_directories(${LIBNAME}_${VERSION} PRIVATE ${INCLUDES})
+        set(${LIBNAME}_LIB ${CMAKE_BINARY_DIR}/${LIBNAME}_${VERSION}.wasm)
+endmacro()
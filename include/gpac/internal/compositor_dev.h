@@ -1964,8 +1964,38 @@ struct _object_clock
 	u64 ocr_discontinuity_time;
 	//we increment this one at each reset, and ask the filter chain to mark packets with this flag
 	u32 timeline_id;
+
+	//sequence counter protecting the clock timing state (init, start and pause times, pause count, speed), odd while being updated
+	volatile u32 seq;
+	//native 64-bit us timeline: time source value at start and pause, and clock time at the last speed change relative to the init timestamp
+	u64 start_time_us, pause_time_us;
+	s64 speed_set_time_us;
+
+	//telemetry, see GF_ClockStats
+	u32 nb_buffer_events, buffer_start_time;
+	u64 buffering_time, paused_time;
+	u32 nb_aus, nb_late_aus, max_lateness;
+	u64 total_lateness;
 };
 
+/*clock telemetry*/
+typedef struct
+{
+	//number of times the clock was stalled for buffering, and total buffering time in ms
+	u32 nb_buffer_events;
+	u64 buffering_time;
+	//total time in ms the clock was paused (buffering included), i.e. delay of the clock relative to the compositor clock in player mode
+	u64 paused_time;
+	//number of AUs checked at decode, how many were late, and their max and average lateness in ms
+	u32 nb_aus, nb_late_aus;
+	u32 max_lateness, avg_lateness;
+} GF_ClockStats;
+
+/*gets telemetry of a clock, e.g. odm->ck for an object manager*/
+void gf_clock_get_stats(GF_Clock *ck, GF_ClockStats *stats);
+/*records the lateness of an AU at decode, as returned by gf_clock_diff (negative if late)*/
+void gf_clock_add_au_lateness(GF_Clock *ck, s32 diff);
+
 /*destroys clock*/
 void gf_clock_del(GF_Clock *ck);
 /*finds a clock by ID or by ES_ID*/
@@ -2010,12 +2040,46 @@ void gf_clock_set_speed(GF_Clock *ck, Fixed speed);
 audio is usually send to the sound card quite ahead of time, depending on the output compositor settings*/
 void gf_clock_set_audio_delay(GF_Clock *ck, s32 ms_delay);
 
+/*sets the time source in ms of all clocks, replacing the compositor clock, for simulated time in benchmarks and stress tests.
+The compositor of the clock passed to get_time may be NULL. If get_time is NULL, the compositor clock is used again*/
+void gf_clock_set_time_source(u32 (*get_time)(void *udta, GF_Compositor *compositor), void *udta);
+
 //convert a 64-bit timestamp to clock time in ms. Clock times are always on 32 bits
 u32 gf_timestamp_to_clocktime(u64 ts, u32 timescale);
 
 //get absolute clock time in ms, including wrapping due to 32bit counting
 u64 gf_clock_time_absolute(GF_Clock *ck);
 
+//get system time in us until the clock reaches the given timestamp in ms, or 0 if already reached or if the clock is not running
+u32 gf_clock_us_until(GF_Clock *ck, u32 ts);
+
+/*64-bit timeline in microseconds, free of 32-bit wrapping
+the clock state is kept in us from the time source and the 32-bit ms clock API is derived from it
+the us resolution of clock time is only achieved with a realtime compositor, other time sources are in ms*/
+//convert a 64-bit timestamp to clock time in us
+u64 gf_timestamp_to_clocktime_us(u64 ts, u32 timescale);
+//get absolute clock time in us
+u64 gf_clock_time_us(GF_Clock *ck);
+//get diff in us between a clock value and a timestamp, both in us on the 64-bit timeline. Same sign convention as gf_clock_diff
+s64 gf_clock_diff_us(GF_Clock *ck, u64 ck_time_us, u64 ts_us);
+
+/*precomputed conversion of timestamps in a given timescale to clock time in us, avoiding a 64-bit division per timestamp*/
+typedef struct
+{
+	u32 timescale;
+	//reduced ratio 1000000/timescale
+	u64 num, den;
+	//reciprocal of den, 0 if den is 1
+	u64 recip;
+	//max timestamp value for which ts*num does not overflow
+	u64 max_ts;
+} GF_TimestampRescaler;
+
+//setup rescaler for the given timescale
+void gf_timestamp_rescaler_init(GF_TimestampRescaler *tsr, u32 timescale);
+//convert a 64-bit timestamp to clock time in us, same as gf_timestamp_to_clocktime_us
+u64 gf_timestamp_rescaler_to_us(GF_TimestampRescaler *tsr, u64 ts);
+
 /*OD manager*/
 
 enum
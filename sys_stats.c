@@ -0,0 +1,546 @@
+/*
+ *			GPAC - Multimedia Framework C SDK
+ *
+ *			Authors: Jean Le Feuvre
+ *			Copyright (c) Telecom ParisTech 2000-2024
+ *					All rights reserved
+ *
+ *  This file is part of GPAC / BIFS and OD decoder filters
+ *
+ *  GPAC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  GPAC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "sys_stats.h"
+
+#if !defined(GPAC_MEMORY_TRACKING)
+#include <malloc.h>
+#endif
+
+static u32 sys_stats_bucket(u32 val)
+{
+	u32 msb;
+	if (val < 16) return val;
+	msb = gf_get_bit_size(val) - 1;
+	//4 sub-buckets per power of 2, using the 2 bits following the MSB
+	return 16 + (msb-4)*4 + ((val >> (msb-2)) & 3);
+}
+
+static u32 sys_stats_bucket_max(u32 idx)
+{
+	u32 msb, sub;
+	u64 max;
+	if (idx < 16) return idx;
+	msb = 4 + (idx-16) / 4;
+	sub = (idx-16) % 4;
+	max = (1ULL<<msb) + ((u64) (sub+1) << (msb-2)) - 1;
+	return (max > 0xFFFFFFFF) ? 0xFFFFFFFF : (u32) max;
+}
+
+void sys_stats_reset(GF_SysStats *stats)
+{
+	memset(stats, 0, sizeof(GF_SysStats));
+}
+
+void sys_stats_add(GF_SysStats *stats, u32 size, u64 dur_us)
+{
+	u32 us = (dur_us > 0xFFFFFFFF) ? 0xFFFFFFFF : (u32) dur_us;
+	if (!stats->nb_aus || (us < stats->min_us)) stats->min_us = us;
+	if (us > stats->max_us) stats->max_us = us;
+	stats->nb_aus++;
+	stats->nb_bytes += size;
+	stats->total_us += us;
+	stats->hist[sys_stats_bucket(us)]++;
+}
+
+static u32 sys_stats_hist_percentile(u32 *hist, u32 nb_vals, u32 max_val, u32 pc)
+{
+	u32 i, nb=0, target;
+	if (!nb_vals) return 0;
+	target = (u32) ( ((u64) nb_vals * pc + 99) / 100);
+	if (!target) target = 1;
+	for (i=0; i<SYS_STATS_HIST_SIZE; i++) {
+		nb += hist[i];
+		if (nb >= target) {
+			u32 max = sys_stats_bucket_max(i);
+			return (max > max_val) ? max_val : max;
+		}
+	}
+	return max_val;
+}
+
+u32 sys_stats_percentile(GF_SysStats *stats, u32 pc)
+{
+	return sys_stats_hist_percentile(stats->hist, stats->nb_aus, stats->max_us, pc);
+}
+
+u32 sys_stats_late_percentile(GF_SysStats *stats, u32 pc)
+{
+	u32 i, nb=0;
+	for (i=0; i<SYS_STATS_HIST_SIZE; i++)
+		nb += stats->late_hist[i];
+	return sys_stats_hist_percentile(stats->late_hist, nb, stats->max_late_us, pc);
+}
+
+void sys_stats_publish(GF_SysStats *stats, GF_FilterPid *opid)
+{
+	if (!opid) return;
+	gf_filter_pid_set_info_str(opid, "dec_aus", &PROP_UINT(stats->nb_aus) );
+	gf_filter_pid_set_info_str(opid, "dec_bytes", &PROP_LONGUINT(stats->nb_bytes) );
+	gf_filter_pid_set_info_str(opid, "dec_min_us", &PROP_UINT(stats->min_us) );
+	gf_filter_pid_set_info_str(opid, "dec_avg_us", &PROP_UINT(stats->nb_aus ? (u32) (stats->total_us / stats->nb_aus) : 0) );
+	gf_filter_pid_set_info_str(opid, "dec_max_us", &PROP_UINT(stats->max_us) );
+	gf_filter_pid_set_info_str(opid, "dec_p99_us", &PROP_UINT(sys_stats_percentile(stats, 99)) );
+	gf_filter_pid_set_info_str(opid, "dec_dropped", &PROP_UINT(stats->nb_dropped) );
+	gf_filter_pid_set_info_str(opid, "dec_late", &PROP_UINT(stats->nb_late) );
+	gf_filter_pid_set_info_str(opid, "dec_gated", &PROP_UINT(stats->nb_gated) );
+	gf_filter_pid_set_info_str(opid, "dec_early", &PROP_UINT(stats->nb_early) );
+	gf_filter_pid_set_info_str(opid, "dec_late_p50_us", &PROP_UINT(sys_stats_late_percentile(stats, 50)) );
+	gf_filter_pid_set_info_str(opid, "dec_late_p99_us", &PROP_UINT(sys_stats_late_percentile(stats, 99)) );
+	gf_filter_pid_set_info_str(opid, "dec_late_max_us", &PROP_UINT(stats->max_late_us) );
+}
+
+Bool sys_stats_sample(u32 *counter, u32 rate)
+{
+	if (rate <= 1) return GF_TRUE;
+	(*counter)++;
+	if (*counter < rate) return GF_FALSE;
+	*counter = 0;
+	return GF_TRUE;
+}
+
+void sys_stats_merge(GF_SysStats *dst, GF_SysStats *src)
+{
+	u32 i;
+	if (!src->nb_aus && !src->nb_dropped && !src->nb_gated) return;
+	if (src->nb_aus) {
+		if (!dst->nb_aus || (src->min_us < dst->min_us)) dst->min_us = src->min_us;
+		if (src->max_us > dst->max_us) dst->max_us = src->max_us;
+	}
+	dst->nb_aus += src->nb_aus;
+	dst->nb_bytes += src->nb_bytes;
+	dst->total_us += src->total_us;
+	dst->nb_dropped += src->nb_dropped;
+	dst->nb_late += src->nb_late;
+	dst->nb_gated += src->nb_gated;
+	dst->nb_early += src->nb_early;
+	if (src->max_late_us > dst->max_late_us) dst->max_late_us = src->max_late_us;
+	for (i=0; i<SYS_STATS_HIST_SIZE; i++) {
+		dst->hist[i] += src->hist[i];
+		dst->late_hist[i] += src->late_hist[i];
+	}
+}
+
+s32 sys_stats_au_lateness(GF_Clock *ck, u64 cts_us, GF_SysStats *stats)
+{
+	s64 diff;
+	if (!ck) return 0;
+	diff = gf_clock_diff_us(ck, gf_clock_time_us(ck), cts_us);
+	if (stats) {
+		if (diff > 0) {
+			stats->nb_early++;
+		} else {
+			u32 late_us = (-diff > 0xFFFFFFFF) ? 0xFFFFFFFF : (u32) -diff;
+			if (late_us > stats->max_late_us) stats->max_late_us = late_us;
+			stats->late_hist[sys_stats_bucket(late_us)]++;
+		}
+	}
+	diff /= 1000;
+	if (diff < -0x7FFFFFFF) diff = -0x7FFFFFFF;
+	else if (diff > 0x7FFFFFFF) diff = 0x7FFFFFFF;
+	gf_clock_add_au_lateness(ck, (s32) diff);
+	return (s32) diff;
+}
+
+void sys_gate_setup(GF_SysGate *gate, GF_FilterPid *pid, u32 immediate_mode)
+{
+	const GF_PropertyValue *p;
+	gate->immediate = GF_FALSE;
+	gate->hold_start = 0;
+	if (immediate_mode == SYS_IMMEDIATE_ALL) {
+		gate->immediate = GF_TRUE;
+	} else if (immediate_mode == SYS_IMMEDIATE_LIVE) {
+		p = gf_filter_pid_get_property(pid, GF_PROP_PID_PLAYBACK_MODE);
+		if (!p || (p->value.uint == GF_PLAYBACK_MODE_NONE))
+			gate->immediate = GF_TRUE;
+		p = gf_filter_pid_get_property_str(pid, "lowlat");
+		if (p && p->value.boolean)
+			gate->immediate = GF_TRUE;
+	}
+}
+
+Bool sys_gate_force(GF_SysGate *gate, GF_Clock *ck, u64 cts_us, u32 max_hold, u32 *wait_us)
+{
+	u32 now, held;
+	*wait_us = 0;
+	//clock paused or not yet started, nothing to apply
+	if (!ck || !gf_clock_is_started(ck)) return GF_FALSE;
+	if (gate->immediate) return GF_TRUE;
+	if (!max_hold) return GF_FALSE;
+
+	now = gf_sys_clock();
+	if (!gate->hold_start || (gate->hold_cts_us != cts_us)) {
+		gate->hold_cts_us = cts_us;
+		gate->hold_start = now ? now : 1;
+	}
+	held = now - gate->hold_start;
+	if (held >= max_hold) {
+		GF_LOG(GF_LOG_INFO, GF_LOG_CODEC, ("[SysDec] AU CTS "LLU" us held %u ms, applying before CTS\n", cts_us, held));
+		return GF_TRUE;
+	}
+	*wait_us = (max_hold - held) * 1000;
+	return GF_FALSE;
+}
+
+void sys_gate_reset(GF_SysGate *gate)
+{
+	gate->hold_start = 0;
+}
+
+//shared frame budget state
+static struct
+{
+	u32 frame_number;
+	u32 start_time;
+	u64 spent_us;
+} sys_budget = {0};
+
+//earliest CTS of pending OD AUs per decoder and clock
+#define SYS_MAX_OD_BARRIERS	16
+static struct
+{
+	void *owner;
+	GF_Clock *ck;
+	u64 cts_us;
+} sys_od_barriers[SYS_MAX_OD_BARRIERS] = {0};
+
+static u32 sys_budget_frame_dur(GF_Compositor *compositor)
+{
+	return (compositor && compositor->frame_duration) ? compositor->frame_duration : 40;
+}
+
+u32 sys_budget_left(GF_Compositor *compositor, u32 frame_budget)
+{
+	u32 now = gf_sys_clock();
+	u32 frame_number = compositor ? compositor->frame_number : 0;
+	//new frame, or no frame drawn for a frame duration (compositor idle)
+	if ((frame_number != sys_budget.frame_number) || (now - sys_budget.start_time >= sys_budget_frame_dur(compositor))) {
+		sys_budget.frame_number = frame_number;
+		sys_budget.start_time = now;
+		sys_budget.spent_us = 0;
+	}
+	if (sys_budget.spent_us >= frame_budget) return 0;
+	return (u32) (frame_budget - sys_budget.spent_us);
+}
+
+void sys_budget_spend(u64 us)
+{
+	sys_budget.spent_us += us;
+}
+
+u32 sys_budget_wait_us(GF_Compositor *compositor)
+{
+	u32 elapsed = gf_sys_clock() - sys_budget.start_time;
+	u32 dur = sys_budget_frame_dur(compositor);
+	return (elapsed >= dur) ? 0 : (dur - elapsed) * 1000;
+}
+
+void sys_od_barrier_set(void *owner, GF_Clock *ck, u64 cts_us)
+{
+	u32 i, free_idx = SYS_MAX_OD_BARRIERS;
+	for (i=0; i<SYS_MAX_OD_BARRIERS; i++) {
+		if (!sys_od_barriers[i].owner) {
+			if (free_idx == SYS_MAX_OD_BARRIERS) free_idx = i;
+			continue;
+		}
+		if ((sys_od_barriers[i].owner != owner) || (sys_od_barriers[i].ck != ck)) continue;
+		if (cts_us < sys_od_barriers[i].cts_us)
+			sys_od_barriers[i].cts_us = cts_us;
+		return;
+	}
+	//table full, BIFS AUs will not wait for this one
+	if (free_idx == SYS_MAX_OD_BARRIERS) return;
+	sys_od_barriers[free_idx].owner = owner;
+	sys_od_barriers[free_idx].ck = ck;
+	sys_od_barriers[free_idx].cts_us = cts_us;
+}
+
+void sys_od_barrier_clear(void *owner)
+{
+	u32 i;
+	for (i=0; i<SYS_MAX_OD_BARRIERS; i++) {
+		if (sys_od_barriers[i].owner == owner)
+			sys_od_barriers[i].owner = NULL;
+	}
+}
+
+Bool sys_od_barrier_blocks(GF_Clock *ck, u64 cts_us)
+{
+	u32 i;
+	for (i=0; i<SYS_MAX_OD_BARRIERS; i++) {
+		if (!sys_od_barriers[i].owner || (sys_od_barriers[i].ck != ck)) continue;
+		if (cts_us >= sys_od_barriers[i].cts_us) return GF_TRUE;
+	}
+	return GF_FALSE;
+}
+
+void sys_stats_publish_clock(GF_Clock *ck, GF_FilterPid *opid)
+{
+	GF_ClockStats cks;
+	if (!ck || !opid) return;
+	gf_clock_get_stats(ck, &cks);
+	gf_filter_pid_set_info_str(opid, "ck_buffer_events", &PROP_UINT(cks.nb_buffer_events) );
+	gf_filter_pid_set_info_str(opid, "ck_buffering_ms", &PROP_LONGUINT(cks.buffering_time) );
+	gf_filter_pid_set_info_str(opid, "ck_paused_ms", &PROP_LONGUINT(cks.paused_time) );
+	gf_filter_pid_set_info_str(opid, "ck_late_aus", &PROP_UINT(cks.nb_late_aus) );
+	gf_filter_pid_set_info_str(opid, "ck_max_late_ms", &PROP_UINT(cks.max_lateness) );
+	gf_filter_pid_set_info_str(opid, "ck_avg_late_ms", &PROP_UINT(cks.avg_lateness) );
+}
+
+//registered heap accounts, queried by the host
+static GF_List *heap_accounts = NULL;
+
+/*process-wide heap in use: with threads on, allocations of other filters and threads are accounted too*/
+static u64 sys_heap_used()
+{
+#if defined(GPAC_MEMORY_TRACKING)
+	return gf_memory_size();
+#elif defined(GPAC_HAS_MALLINFO2)
+	struct mallinfo2 mi = mallinfo2();
+	return (u64) mi.uordblks;
+#else
+	//mallinfo fields are int, bytes in use are below 4GB on wasm32
+	struct mallinfo mi = mallinfo();
+	return (u64) (u32) mi.uordblks;
+#endif
+}
+
+void sys_heap_register(GF_SysHeap *heap, const char *name, void *owner)
+{
+	heap->name = name;
+	heap->owner = owner;
+	if (!heap_accounts) heap_accounts = gf_list_new();
+	if (heap_accounts && (gf_list_find(heap_accounts, heap) < 0))
+		gf_list_add(heap_accounts, heap);
+}
+
+void sys_heap_unregister(GF_SysHeap *heap)
+{
+	if (!heap_accounts) return;
+	gf_list_del_item(heap_accounts, heap);
+	if (!gf_list_count(heap_accounts)) {
+		gf_list_del(heap_accounts);
+		heap_accounts = NULL;
+	}
+}
+
+void sys_heap_begin(GF_SysHeap *heap)
+{
+	heap->mark = sys_heap_used();
+}
+
+void sys_heap_end(GF_SysHeap *heap, u32 bucket)
+{
+	u32 i;
+	s64 total = 0;
+	heap->bytes[bucket] += (s64) sys_heap_used() - (s64) heap->mark;
+	for (i=0; i<SYS_HEAP_LAST; i++)
+		total += heap->bytes[i];
+	if (total > heap->peak_bytes) heap->peak_bytes = total;
+}
+
+void sys_heap_count(GF_SysHeap *heap, GF_SceneGraph *sg, GF_Scene *scene)
+{
+	if (sg) {
+		NodeIDedItem *reg_node = sg->id_node;
+		heap->nb_def_nodes = 0;
+		while (reg_node) {
+			heap->nb_def_nodes++;
+			reg_node = reg_node->next;
+		}
+#ifndef GPAC_DISABLE_VRML
+		heap->nb_routes = gf_list_count(sg->Routes);
+		heap->nb_protos = gf_list_count(sg->protos) + gf_list_count(sg->unregistered_protos);
+#endif
+	}
+	if (scene)
+		heap->nb_odms = gf_list_count(scene->resources);
+}
+
+void sys_heap_publish(GF_SysHeap *heap, GF_FilterPid *opid)
+{
+	if (!opid) return;
+	gf_filter_pid_set_info_str(opid, "heap_scene", &PROP_LONGSINT(heap->bytes[SYS_HEAP_SCENE]) );
+	gf_filter_pid_set_info_str(opid, "heap_coms", &PROP_LONGSINT(heap->bytes[SYS_HEAP_COMS]) );
+	gf_filter_pid_set_info_str(opid, "heap_desc", &PROP_LONGSINT(heap->bytes[SYS_HEAP_DESC]) );
+	gf_filter_pid_set_info_str(opid, "heap_peak", &PROP_LONGSINT(heap->peak_bytes) );
+	gf_filter_pid_set_info_str(opid, "heap_def_nodes", &PROP_UINT(heap->nb_def_nodes) );
+	gf_filter_pid_set_info_str(opid, "heap_routes", &PROP_UINT(heap->nb_routes) );
+	gf_filter_pid_set_info_str(opid, "heap_protos", &PROP_UINT(heap->nb_protos) );
+	gf_filter_pid_set_info_str(opid, "heap_odms", &PROP_UINT(heap->nb_odms) );
+}
+
+/*host query: number of registered heap accounts*/
+u32 EMSCRIPTEN_KEEPALIVE dynCall_sys_heap_count()
+{
+	return gf_list_count(heap_accounts);
+}
+
+/*host query: heap account at the given index, NULL if none*/
+const GF_SysHeap * EMSCRIPTEN_KEEPALIVE dynCall_sys_heap_get(u32 idx)
+{
+	return gf_list_get(heap_accounts, idx);
+}
+
+//registered decoders, queried by the host
+static GF_List *metrics_decoders = NULL;
+
+void sys_metrics_register(GF_SysDecoder *dec)
+{
+	if (!metrics_decoders) metrics_decoders = gf_list_new();
+	if (metrics_decoders && (gf_list_find(metrics_decoders, dec) < 0))
+		gf_list_add(metrics_decoders, dec);
+}
+
+void sys_metrics_unregister(GF_SysDecoder *dec)
+{
+	if (!metrics_decoders) return;
+	gf_list_del_item(metrics_decoders, dec);
+	if (!gf_list_count(metrics_decoders)) {
+		gf_list_del(metrics_decoders);
+		metrics_decoders = NULL;
+	}
+}
+
+/*host query: number of registered decoders*/
+u32 EMSCRIPTEN_KEEPALIVE dynCall_sys_metrics_count()
+{
+	return gf_list_count(metrics_decoders);
+}
+
+/*host query: filter name of the decoder at the given index, NULL if none*/
+const char * EMSCRIPTEN_KEEPALIVE dynCall_sys_metrics_name(u32 idx)
+{
+	GF_SysDecoder *dec = gf_list_get(metrics_decoders, idx);
+	return dec ? dec->name : NULL;
+}
+
+/*host query: upper bound in us of the given histogram bucket*/
+u32 EMSCRIPTEN_KEEPALIVE dynCall_sys_metrics_bucket_max(u32 bucket)
+{
+	if (bucket >= SYS_STATS_HIST_SIZE) return 0xFFFFFFFF;
+	return sys_stats_bucket_max(bucket);
+}
+
+/*host query: fills the metrics of the decoder at the given index*/
+GF_Err EMSCRIPTEN_KEEPALIVE dynCall_sys_metrics_get(u32 idx, GF_SysMetrics *m)
+{
+	GF_SysStats stats;
+	GF_Clock *ck = NULL;
+	GF_SysDecoder *dec = gf_list_get(metrics_decoders, idx);
+	if (!dec || !m) return GF_BAD_PARAM;
+
+	memset(m, 0, sizeof(GF_SysMetrics));
+	sys_stats_reset(&stats);
+	if (dec->get_stats) dec->get_stats(dec->owner, &stats, &ck);
+
+	m->nb_aus = stats.nb_aus;
+	m->nb_dropped = stats.nb_dropped;
+	m->nb_late = stats.nb_late;
+	m->nb_bytes = stats.nb_bytes;
+	m->total_us = stats.total_us;
+	m->min_us = stats.min_us;
+	m->max_us = stats.max_us;
+	m->p50_us = sys_stats_percentile(&stats, 50);
+	m->p90_us = sys_stats_percentile(&stats, 90);
+	m->p99_us = sys_stats_percentile(&stats, 99);
+	memcpy(m->hist, stats.hist, sizeof(m->hist));
+	m->nb_gated = stats.nb_gated;
+	m->nb_early = stats.nb_early;
+	m->late_p50_us = sys_stats_late_percentile(&stats, 50);
+	m->late_p99_us = sys_stats_late_percentile(&stats, 99);
+	m->max_late_us = stats.max_late_us;
+	memcpy(m->late_hist, stats.late_hist, sizeof(m->late_hist));
+	if (ck) {
+		GF_ClockStats cks;
+		gf_clock_get_stats(ck, &cks);
+		m->ck_buffer_events = cks.nb_buffer_events;
+		m->ck_buffering_ms = cks.buffering_time;
+		m->ck_late_aus = cks.nb_late_aus;
+		m->ck_max_late_ms = cks.max_lateness;
+		m->ck_avg_late_ms = cks.avg_lateness;
+	}
+	if (dec->heap) {
+		u32 i;
+		for (i=0; i<SYS_HEAP_LAST; i++)
+			m->heap_bytes += dec->heap->bytes[i];
+		m->heap_peak = dec->heap->peak_bytes;
+	}
+	return GF_OK;
+}
+
+GF_Err sys_trace_open(GF_SysTrace *trace, const char *path, const char *dec_name)
+{
+	u32 len;
+	if (trace->opened) return trace->bs ? GF_OK : GF_IO_ERR;
+	trace->opened = GF_TRUE;
+	trace->file = gf_fopen(path, "wb");
+	if (!trace->file) {
+		GF_LOG(GF_LOG_ERROR, GF_LOG_CODEC, ("[%s] Cannot open trace file %s\n", dec_name, path));
+		return GF_IO_ERR;
+	}
+	trace->bs = gf_bs_from_file(trace->file, GF_BITSTREAM_WRITE);
+	if (!trace->bs) {
+		gf_fclose(trace->file);
+		trace->file = NULL;
+		return GF_OUT_OF_MEM;
+	}
+	trace->start_us = gf_sys_clock_high_res();
+	gf_bs_write_u32(trace->bs, GF_4CC('S','Y','S','T'));
+	gf_bs_write_u8(trace->bs, 1);
+	len = (u32) strlen(dec_name);
+	if (len>255) len = 255;
+	gf_bs_write_u8(trace->bs, len);
+	gf_bs_write_data(trace->bs, (const u8 *) dec_name, len);
+	return GF_OK;
+}
+
+void sys_trace_close(GF_SysTrace *trace)
+{
+	if (trace->bs) gf_bs_del(trace->bs);
+	if (trace->file) gf_fclose(trace->file);
+	trace->bs = NULL;
+	trace->file = NULL;
+}
+
+void sys_trace_write(GF_SysTrace *trace, u8 event, u16 ESID, GF_Clock *ck, u64 cts_us, u32 dur_us)
+{
+	u8 flags = 0;
+	u64 now;
+	if (!trace->bs) return;
+	now = gf_sys_clock_high_res() - trace->start_us;
+	if (ck) {
+		if (ck->clock_init) flags |= 1;
+		if (ck->nb_paused) flags |= 2;
+		if (ck->nb_buffering) flags |= 4;
+	}
+	gf_bs_write_u8(trace->bs, event);
+	gf_bs_write_u8(trace->bs, flags);
+	gf_bs_write_u16(trace->bs, ESID);
+	gf_bs_write_u32(trace->bs, ck ? gf_clock_time(ck) : 0);
+	gf_bs_write_u64(trace->bs, (now > dur_us) ? now - dur_us : 0);
+	gf_bs_write_u64(trace->bs, cts_us);
+	gf_bs_write_u32(trace->bs, dur_us);
+}
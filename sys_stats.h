@@ -0,0 +1,236 @@
+/*
+ *			GPAC - Multimedia Framework C SDK
+ *
+ *			Authors: Jean Le Feuvre
+ *			Copyright (c) Telecom ParisTech 2000-2024
+ *					All rights reserved
+ *
+ *  This file is part of GPAC / BIFS and OD decoder filters
+ *
+ *  GPAC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  GPAC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef _SYS_STATS_H_
+#define _SYS_STATS_H_
+
+#include <gpac/filters.h>
+#include <gpac/internal/compositor_dev.h>
+#include <gpac/internal/scenegraph_dev.h>
+
+/*number of buckets of the decode time histogram: 16 linear buckets for values below 16 us, then 4 buckets per power of 2*/
+#define SYS_STATS_HIST_SIZE	128
+
+/*decode statistics of a system stream (BIFS or OD), one per ESID*/
+typedef struct
+{
+	u32 nb_aus;
+	u64 nb_bytes;
+	u32 min_us, max_us;
+	u64 total_us;
+	/*AUs dropped without being decoded*/
+	u32 nb_dropped;
+	/*AUs decoded after their CTS*/
+	u32 nb_late;
+	u32 hist[SYS_STATS_HIST_SIZE];
+	/*number of times the head AU was checked and found not yet due*/
+	u32 nb_gated;
+	/*AUs decoded before their CTS, and histogram and max of (decode time - CTS) in us for the others*/
+	u32 nb_early;
+	u32 max_late_us;
+	u32 late_hist[SYS_STATS_HIST_SIZE];
+} GF_SysStats;
+
+/*resets all counters*/
+void sys_stats_reset(GF_SysStats *stats);
+/*records one decoded AU of the given size and decode duration*/
+void sys_stats_add(GF_SysStats *stats, u32 size, u64 dur_us);
+/*returns the decode duration in us below which pc percent of the AUs fall (upper bound of the histogram bucket)*/
+u32 sys_stats_percentile(GF_SysStats *stats, u32 pc);
+/*returns the lateness in us below which pc percent of the AUs decoded at or after their CTS fall*/
+u32 sys_stats_late_percentile(GF_SysStats *stats, u32 pc);
+/*publishes counters as info properties of the output PID*/
+void sys_stats_publish(GF_SysStats *stats, GF_FilterPid *opid);
+/*returns TRUE once every rate calls for the given counter, used to sample info property updates (rate 0 or 1 means every call)*/
+Bool sys_stats_sample(u32 *counter, u32 rate);
+/*adds counters of src to dst*/
+void sys_stats_merge(GF_SysStats *dst, GF_SysStats *src);
+
+/*records the lateness of an AU with the given CTS in the clock telemetry and in the stream stats if not NULL, returns the diff in ms between CTS and clock time (negative if late)*/
+s32 sys_stats_au_lateness(GF_Clock *ck, u64 cts_us, GF_SysStats *stats);
+/*publishes telemetry of the clock as info properties of the output PID*/
+void sys_stats_publish_clock(GF_Clock *ck, GF_FilterPid *opid);
+
+/*immediate apply modes*/
+enum
+{
+	/*AUs are applied at CTS*/
+	SYS_IMMEDIATE_NO=0,
+	/*AUs of live or low latency streams are applied on arrival*/
+	SYS_IMMEDIATE_LIVE,
+	/*all AUs are applied on arrival*/
+	SYS_IMMEDIATE_ALL,
+};
+
+/*CTS gating state of a system stream*/
+typedef struct
+{
+	/*AUs of the stream are applied on arrival*/
+	Bool immediate;
+	/*CTS of the AU being held, and system time in ms at which it was first found not due, 0 if none*/
+	u64 hold_cts_us;
+	u32 hold_start;
+} GF_SysGate;
+
+/*sets up the gating state for the given immediate mode: a stream is live or low latency if it has no playback mode (not seekable),
+or if its "lowlat" property is set*/
+void sys_gate_setup(GF_SysGate *gate, GF_FilterPid *pid, u32 immediate_mode);
+/*called for an AU not yet due on a running clock, returns TRUE if it shall be applied anyway: always in immediate mode, otherwise once held
+for max_hold ms (0 means no limit). If not, wait_us is set to the time left before the max hold time is reached, or 0*/
+Bool sys_gate_force(GF_SysGate *gate, GF_Clock *ck, u64 cts_us, u32 max_hold, u32 *wait_us);
+/*resets the hold state once the head AU is applied or dropped*/
+void sys_gate_reset(GF_SysGate *gate);
+
+/*per-frame time budget shared by all system decoders of the session, which all run on the main thread*/
+/*returns the time left in us on the budget of the current compositor frame, 0 if exhausted
+the budget is renewed at each new frame of the compositor, or once a frame duration has elapsed*/
+u32 sys_budget_left(GF_Compositor *compositor, u32 frame_budget);
+/*records time spent on the budget of the current frame*/
+void sys_budget_spend(u64 us);
+/*returns the time in us until the budget is renewed*/
+u32 sys_budget_wait_us(GF_Compositor *compositor);
+
+/*OD barriers, ordering OD AUs before BIFS AUs of the same timeline across the two decoder filters*/
+/*signals an OD AU left pending by the given OD decoder, BIFS AUs on the same clock at or after its CTS shall wait for it*/
+void sys_od_barrier_set(void *owner, GF_Clock *ck, u64 cts_us);
+/*clears all OD AUs signaled by the given OD decoder, called before it processes its AUs and when destroyed*/
+void sys_od_barrier_clear(void *owner);
+/*returns TRUE if a BIFS AU on the given clock and CTS shall wait for pending OD AUs*/
+Bool sys_od_barrier_blocks(GF_Clock *ck, u64 cts_us);
+
+/*heap accounting buckets of a decoder*/
+enum
+{
+	/*nodes, routes and protos created or destroyed when applying scene AUs*/
+	SYS_HEAP_SCENE=0,
+	/*command lists and AU buffers pending for application*/
+	SYS_HEAP_COMS,
+	/*object descriptors and object managers created or destroyed by OD commands*/
+	SYS_HEAP_DESC,
+	SYS_HEAP_LAST
+};
+
+/*heap accounting of a decoder instance, shared with the host as is (pointers are 32 bits in wasm), the layout shall not change.
+Sizes are the net heap growth measured around the decoder operations, the decoders running on the main thread*/
+typedef struct
+{
+	/*net bytes per bucket*/
+	s64 bytes[SYS_HEAP_LAST];
+	/*max of the sum of all buckets*/
+	s64 peak_bytes;
+	/*scene content after the last AU: DEF nodes, routes and protos of the graph, object managers of the scene*/
+	u32 nb_def_nodes, nb_routes, nb_protos, nb_odms;
+	/*filter name and instance, for the host to identify the decoder*/
+	const char *name;
+	void *owner;
+	/*heap usage at the start of the current measure*/
+	u64 mark;
+} GF_SysHeap;
+
+/*registers the heap account of a decoder instance for host queries*/
+void sys_heap_register(GF_SysHeap *heap, const char *name, void *owner);
+/*unregisters the heap account, to call before the account memory is destroyed*/
+void sys_heap_unregister(GF_SysHeap *heap);
+/*starts a heap measure*/
+void sys_heap_begin(GF_SysHeap *heap);
+/*ends a heap measure, adding the heap growth since sys_heap_begin to the given bucket*/
+void sys_heap_end(GF_SysHeap *heap, u32 bucket);
+/*updates scene content counters from the scene graph and the scene (both may be NULL)*/
+void sys_heap_count(GF_SysHeap *heap, GF_SceneGraph *sg, GF_Scene *scene);
+/*publishes heap accounting as info properties of the output PID*/
+void sys_heap_publish(GF_SysHeap *heap, GF_FilterPid *opid);
+
+/*decode metrics of a decoder instance returned to the host, fixed layout*/
+typedef struct
+{
+	u32 nb_aus, nb_dropped, nb_late;
+	u64 nb_bytes;
+	u64 total_us;
+	u32 min_us, max_us, p50_us, p90_us, p99_us;
+	/*decode time histogram, upper bound of each bucket given by dynCall_sys_metrics_bucket_max*/
+	u32 hist[SYS_STATS_HIST_SIZE];
+	/*telemetry of the decoder clock*/
+	u32 ck_buffer_events, ck_late_aus;
+	u64 ck_buffering_ms;
+	u32 ck_max_late_ms, ck_avg_late_ms;
+	/*heap accounting, 0 if not enabled on the decoder*/
+	s64 heap_bytes, heap_peak;
+	/*sys frame gating: number of polls of not yet due AUs, AUs decoded early, lateness percentiles, max and histogram in us*/
+	u32 nb_gated, nb_early;
+	u32 late_p50_us, late_p99_us, max_late_us;
+	u32 late_hist[SYS_STATS_HIST_SIZE];
+} GF_SysMetrics;
+
+/*decoder instance registered for host metrics queries*/
+typedef struct
+{
+	/*filter name and instance*/
+	const char *name;
+	void *owner;
+	/*merges the statistics of all streams of the decoder in stats, and sets the clock of the decoder if any*/
+	void (*get_stats)(void *owner, GF_SysStats *stats, GF_Clock **ck);
+	/*heap account of the decoder, may be NULL*/
+	GF_SysHeap *heap;
+} GF_SysDecoder;
+
+/*registers a decoder for host metrics queries*/
+void sys_metrics_register(GF_SysDecoder *dec);
+/*unregisters a decoder, to call before the decoder is destroyed*/
+void sys_metrics_unregister(GF_SysDecoder *dec);
+
+/*trace events of system AU scheduling*/
+enum
+{
+	/*head AU checked and not yet due*/
+	SYS_TRACE_GATED = 1,
+	/*head AU checked and due, or forced by the gate*/
+	SYS_TRACE_DUE,
+	/*AU decoded or applied, duration is the decode time*/
+	SYS_TRACE_DECODED,
+	/*AU dropped without being decoded*/
+	SYS_TRACE_DROPPED,
+};
+
+/*binary trace of system AU scheduling. The file starts with the 4CC 'SYST', a version byte and the name of the decoder as
+a byte length followed by the characters. Each event is then a big-endian record of 28 bytes: event type (8 bits), clock
+flags (8 bits, 1: clock started, 2: paused, 4: buffering), ESID (16 bits), clock time in ms (32 bits), event start time
+in us since the trace start (64 bits), AU CTS in us (64 bits) and event duration in us (32 bits)*/
+typedef struct
+{
+	FILE *file;
+	GF_BitStream *bs;
+	u64 start_us;
+	/*set once opening was attempted*/
+	Bool opened;
+} GF_SysTrace;
+
+/*opens the trace file, only attempted once*/
+GF_Err sys_trace_open(GF_SysTrace *trace, const char *path, const char *dec_name);
+/*closes the trace file if open*/
+void sys_trace_close(GF_SysTrace *trace);
+/*writes an event ending now, lasting dur_us*/
+void sys_trace_write(GF_SysTrace *trace, u8 event, u16 ESID, GF_Clock *ck, u64 cts_us, u32 dur_us);
+
+#endif //_SYS_STATS_H_